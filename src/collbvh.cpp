@@ -0,0 +1,309 @@
+#include <algorithm>
+
+#include "collbvh.h"
+#include "matter.h"
+
+
+/// @brief spread the lower 10 bits of @a value so that there are two zero bits between each of them
+static uint32_t spreadBits( uint32_t value ) {
+    value = ( value | ( value << 16 ) ) & 0x030000ff;
+    value = ( value | ( value <<  8 ) ) & 0x0300f00f;
+    value = ( value | ( value <<  4 ) ) & 0x030c30c3;
+    value = ( value | ( value <<  2 ) ) & 0x09249249;
+    return value;
+}
+
+
+/// @brief return the surface of the box @a lo / @a hi, zero if it is empty
+static double surface( const double* lo, const double* hi ) {
+    if ( lo[0] > hi[0] )
+        return 0.;
+    double dX = hi[0] - lo[0];
+    double dY = hi[1] - lo[1];
+    double dZ = hi[2] - lo[2];
+    return 2. * ( ( dX * dY ) + ( dY * dZ ) + ( dZ * dX ) );
+}
+
+
+/// @brief return true if the boxes @a aLo / @a aHi and @a bLo / @a bHi overlap
+static bool boxOverlap( const double* aLo, const double* aHi, const double* bLo, const double* bHi ) {
+    return !( ( aHi[0] < bLo[0] ) || ( aLo[0] > bHi[0] )
+           || ( aHi[1] < bLo[1] ) || ( aLo[1] > bHi[1] )
+           || ( aHi[2] < bLo[2] ) || ( aLo[2] > bHi[2] ) );
+}
+
+
+/** @brief build the hierarchy anew from the given units
+  *
+  * @param[in] units Array of all units in container order
+  * @param[in] count Number of units in @a units
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the tables could not be allocated
+**/
+int32_t CCollBVH::build( CMatter** units, int32_t count ) {
+    std::vector<std::pair<uint32_t, int32_t> > order; // Morton code and item index
+    std::vector<sBvhItem> sorted;
+    std::vector<uint32_t> codes;
+
+    try {
+        // 1.: Gather all units that take part
+        items.clear();
+        items.reserve( count );
+        for ( int32_t i = 0; i < count; ++i ) {
+            if ( !units[i]->destroyed() ) {
+                sBvhItem item;
+                item.unit = units[i];
+                item.nr   = 0;
+                setBox( item );
+                items.push_back( item );
+            }
+        }
+
+        int32_t itemCount = static_cast<int32_t>( items.size() );
+        order.resize( itemCount );
+        sorted.resize( itemCount );
+        codes.resize( itemCount );
+        nodes.clear();
+        nodes.reserve( itemCount ? ( 4 * itemCount / leafSize ) + 1 : 0 );
+
+        // 2.: Determine the range of the box centers...
+        double cMin[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+        double cMax[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+        for ( int32_t i = 0; i < itemCount; ++i ) {
+            for ( int32_t a = 0; a < 3; ++a ) {
+                double center = ( items[i].lo[a] + items[i].hi[a] ) / 2.;
+                if ( center < cMin[a] ) cMin[a] = center;
+                if ( center > cMax[a] ) cMax[a] = center;
+            }
+        }
+
+        // 3.: ...to give every unit a 30 bit Morton code of its center...
+        for ( int32_t i = 0; i < itemCount; ++i ) {
+            uint32_t code = 0;
+            for ( int32_t a = 0; a < 3; ++a ) {
+                double   range  = cMax[a] - cMin[a];
+                double   center = ( items[i].lo[a] + items[i].hi[a] ) / 2.;
+                uint32_t cell   = range > 0. ? static_cast<uint32_t>( 1023. * ( center - cMin[a] ) / range ) : 0;
+                code |= spreadBits( cell ) << ( 2 - a );
+            }
+            order[i].first  = code;
+            order[i].second = i;
+        }
+
+        // 4.: ...sort them along the curve...
+        std::sort( order.begin(), order.end() );
+        for ( int32_t i = 0; i < itemCount; ++i ) {
+            sorted[i] = items[order[i].second];
+            codes[i]  = order[i].first;
+        }
+        items.swap( sorted );
+
+        // 5.: ...and split them into nodes.
+        if ( itemCount )
+            buildNode( codes, 0, itemCount );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the bounding volume hierarchy for " << count << " units! [";
+        cerr << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    buildCost = refit();
+    buildSize = static_cast<int32_t>( items.size() );
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief build the node for the items @a first to @a first + @a count - 1
+  *
+  * The items must be sorted by their @a codes. They are split where the
+  * highest bit that differs between the first and the last code changes, or in
+  * the middle if all codes are equal.
+**/
+void CCollBVH::buildNode( const std::vector<uint32_t>& codes, int32_t first, int32_t count ) {
+    int32_t idx = static_cast<int32_t>( nodes.size() );
+    sBvhNode node;
+    node.first = first;
+    node.count = count;
+    node.right = -1;
+    nodes.push_back( node );
+
+    if ( count <= leafSize )
+        return;
+
+    uint32_t firstCode = codes[first];
+    uint32_t lastCode  = codes[first + count - 1];
+    int32_t  split     = count / 2;
+
+    if ( firstCode != lastCode ) {
+        int32_t bit = 0;
+        while ( ( firstCode ^ lastCode ) >> ( bit + 1 ) )
+            ++bit;
+        // All codes up to key share the prefix of the first code and have the differing bit unset
+        uint32_t key = ( ( firstCode >> bit ) << bit ) | ( ( 1U << bit ) - 1 );
+        split = static_cast<int32_t>( std::upper_bound( codes.begin() + first, codes.begin() + first + count, key )
+                                      - ( codes.begin() + first ) );
+    }
+
+    nodes[idx].count = 0;
+    buildNode( codes, first, split );
+    nodes[idx].right = static_cast<int32_t>( nodes.size() );
+    buildNode( codes, first + split, count - split );
+}
+
+
+/// @brief fill @a result with the numbers of all other units whose boxes overlap with the one of @a nr
+void CCollBVH::overlaps( int32_t nr, std::vector<int32_t>& result ) const {
+    const sBvhItem& item = items[slot[nr]];
+    int32_t         stack[128]; // The tree is never deeper than 30 bit splits plus 32 middle splits
+    int32_t         top = 0;
+
+    result.clear();
+    if ( nodes.empty() )
+        return;
+
+    stack[top++] = 0;
+    while ( top ) {
+        int32_t         idx  = stack[--top];
+        const sBvhNode& node = nodes[idx];
+        if ( !boxOverlap( node.lo, node.hi, item.lo, item.hi ) )
+            continue;
+        if ( node.right < 0 ) {
+            for ( int32_t i = node.first; i < node.first + node.count; ++i ) {
+                if ( ( items[i].nr != nr ) && boxOverlap( items[i].lo, items[i].hi, item.lo, item.hi ) )
+                    result.push_back( items[i].nr );
+            }
+        } else {
+            stack[top++] = node.right;
+            stack[top++] = idx + 1;
+        }
+    }
+}
+
+
+/** @brief recalculate all boxes from the bottom up and drop destroyed units from the leaves
+  *
+  * See CMatter::destroyed() for why the leaves have to be cleaned here.
+  *
+  * @return the summed up surface of all nodes relative to the root surface
+**/
+double CCollBVH::refit() {
+    double total = 0.;
+
+    // Children always come after their parents, so walking backwards refits them first
+    for ( int32_t idx = static_cast<int32_t>( nodes.size() ) - 1; idx >= 0; --idx ) {
+        sBvhNode& node = nodes[idx];
+        for ( int32_t a = 0; a < 3; ++a ) {
+            node.lo[a] =  HUGE_VAL;
+            node.hi[a] = -HUGE_VAL;
+        }
+
+        if ( node.right < 0 ) {
+            int32_t kept = 0;
+            for ( int32_t i = node.first; i < node.first + node.count; ++i ) {
+                if ( !items[i].unit->destroyed() ) {
+                    sBvhItem& item = items[node.first + kept++];
+                    item = items[i];
+                    setBox( item );
+                    for ( int32_t a = 0; a < 3; ++a ) {
+                        if ( item.lo[a] < node.lo[a] ) node.lo[a] = item.lo[a];
+                        if ( item.hi[a] > node.hi[a] ) node.hi[a] = item.hi[a];
+                    }
+                }
+            }
+            node.count = kept;
+        } else {
+            const sBvhNode& left  = nodes[idx + 1];
+            const sBvhNode& right = nodes[node.right];
+            for ( int32_t a = 0; a < 3; ++a ) {
+                node.lo[a] = std::min( left.lo[a], right.lo[a] );
+                node.hi[a] = std::max( left.hi[a], right.hi[a] );
+            }
+        }
+
+        total += surface( node.lo, node.hi );
+    } // End of walking the nodes
+
+    double rootSurface = nodes.empty() ? 0. : surface( nodes[0].lo, nodes[0].hi );
+    return rootSurface > 0. ? total / rootSurface : 1.;
+}
+
+
+/// @brief set the collision box of @a item from its unit
+void CCollBVH::setBox( sBvhItem& item ) const {
+    CMatter* unit   = item.unit;
+    // Two extents add up to the collision range, see CCollSAP::refresh()
+    double   extent = ( margin * ( unit->getRadius() + 0.5 ) ) + ( stepMod * unit->getMovement() ) + ( skin / 2. );
+    double   pos[3] = { unit->getPosX(), unit->getPosY(), unit->getPosZ() };
+
+    for ( int32_t a = 0; a < 3; ++a ) {
+        item.lo[a] = pos[a] - extent;
+        item.hi[a] = pos[a] + extent;
+    }
+}
+
+
+/** @brief refit or rebuild the hierarchy with the current unit positions
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] units Array of all units in container order
+  * @param[in] count Number of units in @a units
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the tables could not be allocated
+**/
+int32_t CCollBVH::update( ENVIRONMENT* env, CMatter** units, int32_t count ) {
+    assert( env && env->universe && "ERROR: CCollBVH::update() called without valid universe!" );
+
+    int32_t result = EXIT_SUCCESS;
+
+    margin  = env->universe->M2Pos;
+    skin    = env->collSkin;
+    stepMod = env->doSweep ? env->universe->M2Pos * env->secPFmod : 0.;
+
+    // 1.: Count the units that take part
+    int32_t alive = 0;
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( !units[i]->destroyed() )
+            ++alive;
+    }
+
+    // 2.: Refit, unless a quarter of the units is gone since the last build
+    bool doBuild = nodes.empty() || ( ( 4 * alive ) < ( 3 * buildSize ) );
+    if ( !doBuild ) {
+        double  cost = refit();
+        int32_t kept = 0;
+        for ( size_t idx = 0; idx < nodes.size(); ++idx ) {
+            if ( nodes[idx].right < 0 )
+                kept += nodes[idx].count;
+        }
+        // Units are never added after the initialization, so different numbers mean new data
+        doBuild = ( kept != alive ) || ( cost > ( 2. * buildCost ) );
+    }
+
+    // 3.: Build anew if needed
+    if ( doBuild )
+        result = build( units, count );
+
+    // 4.: Number the units in leaf order
+    if ( EXIT_SUCCESS == result ) {
+        try {
+            slot.resize( alive );
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR: unable to allocate the bounding volume hierarchy for " << count << " units! [";
+            cerr << e.what() << "]" << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    if ( EXIT_SUCCESS == result ) {
+        int32_t nr = 0;
+        for ( size_t idx = 0; idx < nodes.size(); ++idx ) {
+            if ( nodes[idx].right < 0 ) {
+                for ( int32_t i = nodes[idx].first; i < nodes[idx].first + nodes[idx].count; ++i ) {
+                    items[i].nr = nr;
+                    slot[nr++]  = i;
+                }
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef PWX_GRAVMAT_COLLBVH_H_INCLUDED
+#define PWX_GRAVMAT_COLLBVH_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+
+/// @brief One unit in the hierarchy together with its collision box
+struct sBvhItem {
+    double   lo[3]; //!< Lower corner of the collision box in positional coordinates
+    double   hi[3]; //!< Upper corner of the collision box in positional coordinates
+    CMatter* unit;  //!< The unit this box belongs to
+    int32_t  nr;    //!< Number of the unit as handed out by getUnit() and overlaps()
+};
+
+
+/// @brief One node of the hierarchy, the left child always directly follows its parent
+struct sBvhNode {
+    double  lo[3]; //!< Lower corner of the box around all items below
+    double  hi[3]; //!< Upper corner of the box around all items below
+    int32_t first; //!< Leaves only: First item of the leaf
+    int32_t count; //!< Leaves only: Number of (not destroyed) items of the leaf
+    int32_t right; //!< Index of the right child, -1 for leaves
+};
+
+
+/** @class CCollBVH
+  * @brief Bounding volume hierarchy over the units as a collision broad-phase
+  *
+  * Every unit gets an axis aligned collision box of its position plus/minus
+  * its radius plus half a meter (plus its last step with --ccd, plus half the
+  * skin thrdCheck() measures the gaps over), so two boxes overlap whenever the
+  * units might collide. The boxes are ordered along a
+  * Morton curve of their centers and split at the highest differing bit of
+  * their codes (LBVH), which is an O(N log N) sort and an O(N) build.
+  *
+  * Units move only a little each second, so the hierarchy is not built anew
+  * but refitted: the boxes of all nodes are recalculated from the bottom up
+  * and destroyed units are dropped from their leaves, which is O(N). Only if
+  * the summed up node surfaces, relative to the root surface, have doubled
+  * since the last build, or a quarter of the units is gone, is it rebuilt.
+  *
+  * Asking for the overlaps of one unit walks down only the nodes its box
+  * touches, which does not depend on how the units cluster on shells.
+**/
+class CCollBVH {
+    std::vector<sBvhItem> items;     //!< Units in Morton order, grouped by leaf
+    std::vector<sBvhNode> nodes;     //!< The hierarchy in pre-order, nodes[0] is the root
+    std::vector<int32_t>  slot;      //!< Item index per unit number
+    double                buildCost; //!< Relative surface sum right after the last build
+    int32_t               buildSize; //!< Number of units at the last build
+    double                margin;    //!< One meter in positional coordinates, see UNIVERSE::M2Pos
+    double                skin;      //!< Extra range in positional coordinates, see ENVIRONMENT::collSkin
+    double                stepMod;   //!< Turns a movement into the length of the last step with --ccd, zero otherwise
+
+    static const int32_t  leafSize = 4; //!< Maximum number of units in a leaf
+
+    // Build the hierarchy anew from the given units:
+    int32_t build   ( CMatter** units, int32_t count ) PWX_WARNUNUSED;
+    // Build the node for the items first to first + count - 1, which are sorted by their codes:
+    void    buildNode( const std::vector<uint32_t>& codes, int32_t first, int32_t count );
+    // Recalculate all boxes, drop destroyed units and return the relative surface sum:
+    double  refit   ();
+    // Set the collision box of an item from its unit:
+    void    setBox  ( sBvhItem& item ) const;
+
+  public:
+    /// @brief default ctor, the hierarchy is built by update()
+    explicit CCollBVH(): buildCost( 0.0 ), buildSize( 0 ), margin( 1.0 ), skin( 0.0 ), stepMod( 0.0 ) { }
+
+    /// @brief default dtor, does nothing.
+    ~CCollBVH() { }
+
+    /// @brief return the unit with the number @a nr
+    CMatter* getUnit( int32_t nr ) const { return items[slot[nr]].unit; }
+
+    // Fill result with the numbers of all other units whose boxes overlap with the one of nr:
+    void     overlaps( int32_t nr, std::vector<int32_t>& result ) const;
+
+    /// @brief return the number of units in the hierarchy
+    int32_t  size() const { return static_cast<int32_t>( slot.size() ); }
+
+    // Refit or rebuild the hierarchy with the current unit positions:
+    int32_t  update( ENVIRONMENT* env, CMatter** units, int32_t count ) PWX_WARNUNUSED;
+
+  private:
+    /* --- no copying! --- */
+    CCollBVH( CCollBVH& );
+    CCollBVH& operator=( CCollBVH& );
+};
+
+#endif // PWX_GRAVMAT_COLLBVH_H_INCLUDED
+
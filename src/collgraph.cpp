@@ -0,0 +1,110 @@
+#include "collgraph.h"
+
+
+/** @brief join all pairs into groups of units
+  *
+  * @param[in] count Number of units the pair numbers refer to
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the tables could not be allocated
+**/
+int32_t CCollGraph::build( int32_t count ) {
+    size_t pairCount = 0;
+    for ( size_t tNum = 0; tNum < pairs.size(); ++tNum )
+        pairCount += pairs[tNum].size();
+
+    // A group has at least two units, and every unit is in one group at most
+    size_t maxMembers = pairCount * 2 < static_cast<size_t>( count ) ? pairCount * 2 : count;
+    std::vector<int32_t> groupNr;   // Group number per root
+    std::vector<int32_t> groupSize; // Units per group, counted down again while filling
+
+    try {
+        parent.assign( count, -1 );
+        impact.assign( count, 1. );
+        groupNr.assign( count, -1 );
+        groupSize.reserve( maxMembers / 2 );
+        groupPos.reserve( ( maxMembers / 2 ) + 1 );
+        groupPos.assign( 1, 0 );
+        members.reserve( maxMembers );
+        members.clear();
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the merge graph for " << count << " units! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // 1.: Join the pairs. The smaller root always becomes the parent, so every
+    //     root is the smallest unit number of its group, whatever the pair order.
+    //     Every unit keeps the earliest impact of all pairs it is in.
+    for ( size_t tNum = 0; tNum < pairs.size(); ++tNum ) {
+        for ( size_t pNr = 0; pNr < pairs[tNum].size(); ++pNr ) {
+            int32_t a   = pairs[tNum][pNr].a;
+            int32_t b   = pairs[tNum][pNr].b;
+            double  toi = pairs[tNum][pNr].toi;
+            if ( toi < impact[a] ) impact[a] = toi;
+            if ( toi < impact[b] ) impact[b] = toi;
+            if ( parent[a] < 0 ) parent[a] = a;
+            if ( parent[b] < 0 ) parent[b] = b;
+            a = findRoot( a );
+            b = findRoot( b );
+            if      ( a < b ) parent[b] = a;
+            else if ( b < a ) parent[a] = b;
+        }
+    }
+
+    // 2.: Count the group sizes at their roots. Roots come first in their
+    //     group, so all counts are known when the walk reaches a root.
+    for ( int32_t nr = 0; nr < count; ++nr ) {
+        if ( parent[nr] < 0 )
+            continue;
+        int32_t root = findRoot( nr );
+        if ( root == nr ) {
+            groupNr[nr] = static_cast<int32_t>( groupSize.size() );
+            groupSize.push_back( 0 );
+        }
+        ++groupSize[groupNr[root]];
+    }
+
+    // 3.: Turn the sizes into start positions and fill the groups in ascending order
+    int32_t groupCount = static_cast<int32_t>( groupSize.size() );
+    groupPos.resize( groupCount + 1 );
+    for ( int32_t gNr = 0; gNr < groupCount; ++gNr )
+        groupPos[gNr + 1] = groupPos[gNr] + groupSize[gNr];
+    members.resize( groupPos[groupCount] );
+
+    for ( int32_t nr = 0; nr < count; ++nr ) {
+        if ( parent[nr] < 0 )
+            continue;
+        int32_t gNr = groupNr[findRoot( nr )];
+        members[groupPos[gNr + 1] - groupSize[gNr]--] = nr;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/// @brief return the root of the tree @a nr is in, halving the path on the way
+int32_t CCollGraph::findRoot( int32_t nr ) {
+    while ( parent[nr] != nr ) {
+        parent[nr] = parent[parent[nr]];
+        nr         = parent[nr];
+    }
+    return nr;
+}
+
+
+/** @brief empty all pair lists and make sure there is one per thread
+  *
+  * @param[in] numThreads Number of threads that will call addPair()
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the lists could not be allocated
+**/
+int32_t CCollGraph::reset( int32_t numThreads ) {
+    try {
+        pairs.resize( numThreads );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << numThreads << " collision pair lists! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    for ( int32_t tNum = 0; tNum < numThreads; ++tNum )
+        pairs[tNum].clear();
+
+    return EXIT_SUCCESS;
+}
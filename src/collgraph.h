@@ -0,0 +1,79 @@
+#pragma once
+#ifndef PWX_GRAVMAT_COLLGRAPH_H_INCLUDED
+#define PWX_GRAVMAT_COLLGRAPH_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+
+/// @brief Two colliding units, always with a < b
+struct sCollPair {
+    int32_t a;   //!< The smaller unit number
+    int32_t b;   //!< The larger unit number
+    double  toi; //!< Time of impact as the fraction of the last step, see CMatter::isColliding()
+};
+
+
+/** @class CCollGraph
+  * @brief Merge graph that turns the colliding pairs into groups of units to merge
+  *
+  * thrdCheck() does not merge anything, it writes every colliding pair into
+  * the pair list of its thread. Afterwards build() joins all pairs into
+  * connected groups with a union-find. Every group is merged into one unit by
+  * one thread in thrdMerge(), so no unit is ever touched by two threads.
+  *
+  * The groups do not depend on the order the pairs were found in, they are
+  * ordered by their smallest unit number and hold their units in ascending
+  * order. The merging is therefore the same no matter how many threads are
+  * used, and a pile of several units is merged in one go.
+**/
+class CCollGraph {
+    std::vector<std::vector<sCollPair> > pairs;    //!< Colliding pairs, one list per thread
+    std::vector<int32_t>                 parent;   //!< Union-find parent per unit number, -1 if not colliding
+    std::vector<double>                  impact;   //!< Earliest time of impact per unit number, 1.0 if not colliding
+    std::vector<int32_t>                 groupPos; //!< Start of each group in members, the extra last entry is the end
+    std::vector<int32_t>                 members;  //!< Unit numbers ordered by group, ascending within each group
+
+    // Return the root of the tree nr is in:
+    int32_t findRoot( int32_t nr ) PWX_WARNUNUSED;
+
+  public:
+    /// @brief default ctor, the lists are allocated by reset()
+    explicit CCollGraph() { }
+
+    /// @brief default dtor, does nothing.
+    ~CCollGraph() { }
+
+    /// @brief note that the units @a a and @a b collide at @a toi, thread @a tNum may only use its own list
+    void    addPair( int32_t tNum, int32_t a, int32_t b, double toi = 1. ) {
+        sCollPair pair = { a < b ? a : b, a < b ? b : a, toi };
+        pairs[tNum].push_back( pair );
+    }
+
+    // Join all pairs into groups of units:
+    int32_t build( int32_t count ) PWX_WARNUNUSED;
+
+    /// @brief return the unit numbers of group @a nr
+    const int32_t* getGroup( int32_t nr ) const { return &members[groupPos[nr]]; }
+
+    /// @brief return the earliest time of impact of every unit by unit number, as found by build()
+    const double* getImpacts() const { return impact.data(); }
+
+    /// @brief return the number of units in group @a nr
+    int32_t getGroupSize( int32_t nr ) const { return groupPos[nr + 1] - groupPos[nr]; }
+
+    /// @brief return the number of groups found by build()
+    int32_t groups() const { return static_cast<int32_t>( groupPos.size() ) - 1; }
+
+    // Empty all pair lists and make sure there is one per thread:
+    int32_t reset( int32_t numThreads ) PWX_WARNUNUSED;
+
+  private:
+    /* --- no copying! --- */
+    CCollGraph( CCollGraph& );
+    CCollGraph& operator=( CCollGraph& );
+};
+
+#endif // PWX_GRAVMAT_COLLGRAPH_H_INCLUDED
+
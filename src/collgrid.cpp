@@ -0,0 +1,122 @@
+#include "collgrid.h"
+#include "matter.h"
+
+
+/** @brief sort all units into the grid
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] units Array of all units in container order
+  * @param[in] count Number of units in @a units
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the tables could not be allocated
+**/
+int32_t CCollGrid::build( ENVIRONMENT* env, CMatter** units, int32_t count ) {
+    assert( env && env->universe && "ERROR: CCollGrid::build() called without valid universe!" );
+
+    const double M_to_Pos = env->universe->M2Pos;
+
+    // 1.: The cell size is the largest range two units can collide over, see thrdCheck()
+    //     With --ccd both units might have come from up to one full step away.
+    double maxRadius = 0.;
+    double maxMove   = 0.;
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( !units[i]->destroyed() ) {
+            if ( units[i]->getRadius() > maxRadius )
+                maxRadius = units[i]->getRadius();
+            if ( env->doSweep && ( units[i]->getMovement() > maxMove ) )
+                maxMove = units[i]->getMovement();
+        }
+    }
+    cellSize = M_to_Pos + ( M_to_Pos * 2. * maxRadius ) + ( M_to_Pos * 2. * maxMove * env->secPFmod ) + env->collSkin;
+
+    // 2.: Make room. The bucket table has at least twice the size of the unit count
+    uint32_t tableSize = 64;
+    while ( tableSize < ( 2U * static_cast<uint32_t>( count ) ) )
+        tableSize <<= 1;
+    keyMask = tableSize - 1;
+
+    try {
+        bucketPos.assign( tableSize + 1, 0 );
+        items.resize( count );
+        cellX.resize( count );
+        cellY.resize( count );
+        cellZ.resize( count );
+        unitKey.resize( count );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the collision grid for " << count << " units! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // 3.: Determine the cell of each unit and count the bucket sizes
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( units[i]->destroyed() ) {
+            unitKey[i] = noKey;
+            continue;
+        }
+        cellX[i]   = static_cast<int64_t>( std::floor( units[i]->getPosX() / cellSize ) );
+        cellY[i]   = static_cast<int64_t>( std::floor( units[i]->getPosY() / cellSize ) );
+        cellZ[i]   = static_cast<int64_t>( std::floor( units[i]->getPosZ() / cellSize ) );
+        unitKey[i] = hashCell( cellX[i], cellY[i], cellZ[i] );
+        ++bucketPos[unitKey[i] + 1];
+    }
+
+    // 4.: Turn the sizes into start positions...
+    for ( uint32_t k = 1; k <= tableSize; ++k )
+        bucketPos[k] += bucketPos[k - 1];
+
+    // 5.: ...fill the buckets, which moves each start position to the start of the next bucket...
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( noKey != unitKey[i] )
+            items[bucketPos[unitKey[i]]++] = i;
+    }
+
+    // 6.: ...and move them back.
+    for ( uint32_t k = tableSize; k > 0; --k )
+        bucketPos[k] = bucketPos[k - 1];
+    bucketPos[0] = 0;
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief fill @a result with all other units in the surrounding cells
+  *
+  * Units that merely share a bucket with one of the surrounding cells are
+  * filtered out by their cell coordinates.
+**/
+void CCollGrid::neighbours( int32_t nr, std::vector<int32_t>& result ) const {
+    result.clear();
+
+    if ( noKey == unitKey[nr] )
+        return;
+
+    const int64_t cX = cellX[nr];
+    const int64_t cY = cellY[nr];
+    const int64_t cZ = cellZ[nr];
+
+    // Several of the 27 cells might share a bucket, which must then be looked at only once:
+    uint32_t keys[27];
+    int32_t  keyCount = 0;
+    for ( int64_t x = cX - 1; x <= cX + 1; ++x ) {
+        for ( int64_t y = cY - 1; y <= cY + 1; ++y ) {
+            for ( int64_t z = cZ - 1; z <= cZ + 1; ++z ) {
+                uint32_t key   = hashCell( x, y, z );
+                bool     isNew = true;
+                for ( int32_t k = 0; isNew && ( k < keyCount ); ++k )
+                    isNew = keys[k] != key;
+                if ( isNew )
+                    keys[keyCount++] = key;
+            }
+        }
+    }
+
+    for ( int32_t k = 0; k < keyCount; ++k ) {
+        for ( int32_t p = bucketPos[keys[k]]; p < bucketPos[keys[k] + 1]; ++p ) {
+            int32_t other = items[p];
+            if ( ( other != nr )
+                    && ( std::abs( cellX[other] - cX ) < 2 )
+                    && ( std::abs( cellY[other] - cY ) < 2 )
+                    && ( std::abs( cellZ[other] - cZ ) < 2 ) )
+                result.push_back( other );
+        }
+    }
+}
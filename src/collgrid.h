@@ -0,0 +1,70 @@
+#pragma once
+#ifndef PWX_GRAVMAT_COLLGRID_H_INCLUDED
+#define PWX_GRAVMAT_COLLGRID_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+
+/** @class CCollGrid
+  * @brief Uniform 3D spatial hash used as the broad-phase of the collision check
+  *
+  * The radial scan in thrdCheck() considers every unit on the same spherical
+  * shell around the center to be a candidate, no matter on which side of the
+  * universe it is. The grid sorts all units into cubic cells instead. The edge
+  * length of a cell is the largest range two units can collide over, which is
+  * derived from the largest radius (and the largest step if --ccd is used),
+  * plus the skin thrdCheck() measures the gaps over.
+  * Two units can therefore only collide if
+  * their cells are direct neighbours, and applyCollision() has to be called for
+  * units in the 27 surrounding cells only.
+  *
+  * The cells are not stored as such. Their coordinates are hashed into a bucket
+  * table of (at least) twice the number of units, which is filled by a counting
+  * sort. Building the grid is therefore O(N) and does not allocate once the
+  * tables have grown to the number of units.
+**/
+class CCollGrid {
+    double                cellSize;  //!< Edge length of one cell in positional coordinates
+    std::vector<int32_t>  bucketPos; //!< Start of each bucket in items, the extra last entry is the end
+    std::vector<int32_t>  items;     //!< Unit numbers ordered by bucket, ascending within each bucket
+    std::vector<int64_t>  cellX;     //!< Cell X-Coordinate per unit number
+    std::vector<int64_t>  cellY;     //!< Cell Y-Coordinate per unit number
+    std::vector<int64_t>  cellZ;     //!< Cell Z-Coordinate per unit number
+    std::vector<uint32_t> unitKey;   //!< Bucket per unit number, noKey for destroyed units
+    uint32_t              keyMask;   //!< Bucket table size minus one, the size is always a power of two
+
+    static const uint32_t noKey = 0xffffffff; //!< Bucket "number" of units that are not in the grid
+
+    /// @brief return the bucket a cell is hashed into
+    uint32_t hashCell( int64_t x, int64_t y, int64_t z ) const PWX_WARNUNUSED {
+        return static_cast<uint32_t>(  ( static_cast<uint64_t>( x ) * 73856093ULL )
+                                     ^ ( static_cast<uint64_t>( y ) * 19349663ULL )
+                                     ^ ( static_cast<uint64_t>( z ) * 83492791ULL ) ) & keyMask;
+    }
+
+  public:
+    /// @brief default ctor, the tables are allocated by build()
+    explicit CCollGrid(): cellSize( 1.0 ), keyMask( 0 ) { }
+
+    /// @brief default dtor, does nothing.
+    ~CCollGrid() { }
+
+    // Sort all units into the grid:
+    int32_t build( ENVIRONMENT* env, CMatter** units, int32_t count ) PWX_WARNUNUSED;
+
+    /// @brief return the edge length of a cell in positional coordinates
+    double  getCellSize() const { return cellSize; }
+
+    // Fill result with all other units in the surrounding cells:
+    void    neighbours( int32_t nr, std::vector<int32_t>& result ) const;
+
+  private:
+    /* --- no copying! --- */
+    CCollGrid( CCollGrid& );
+    CCollGrid& operator=( CCollGrid& );
+};
+
+#endif // PWX_GRAVMAT_COLLGRID_H_INCLUDED
+
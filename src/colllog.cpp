@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "colllog.h"
+
+
+/// @brief order records by second, survivor and destroyed unit
+static bool recordLess( const sCollRecord& lhs, const sCollRecord& rhs ) {
+    if ( lhs.second != rhs.second )
+        return lhs.second < rhs.second;
+    if ( lhs.survivorId != rhs.survivorId )
+        return lhs.survivorId < rhs.survivorId;
+    return lhs.destroyedId < rhs.destroyedId;
+}
+
+
+/// @brief stop the writer and write what is left
+CCollLog::~CCollLog() {
+    flush();
+
+    if ( writer ) {
+        writing = false;
+        writer->Wait();
+        delete writer;
+        writer = NULL;
+    }
+
+    if ( outFile.good() )
+        writePending();
+
+    int64_t lost = 0;
+    for ( size_t tNum = 0; tNum < dropped.size(); ++tNum )
+        lost += dropped[tNum];
+    if ( lost )
+        cerr << "WARNING: " << lost << " merges could not be logged for lack of memory!" << endl;
+
+    if ( outFile.is_open() )
+        outFile.close();
+}
+
+
+/** @brief hand the records of all threads over to the writer
+  *
+  * This must be called while no thread records anything. If the writer had
+  * to stop, the records are thrown away. Records that do not fit into the
+  * pending list are counted as dropped.
+**/
+void CCollLog::flush() {
+    if ( !writing ) {
+        for ( size_t tNum = 0; tNum < buffers.size(); ++tNum )
+            buffers[tNum].clear();
+        return;
+    }
+
+    lock();
+    size_t oldSize = pending.size();
+    for ( size_t tNum = 0; tNum < buffers.size(); ++tNum ) {
+        try {
+            pending.insert( pending.end(), buffers[tNum].begin(), buffers[tNum].end() );
+        } catch ( std::bad_alloc& ) {
+            // pending is left as it was, the records of this thread are lost and reported by the dtor
+            dropped[tNum] += buffers[tNum].size();
+        }
+        buffers[tNum].clear();
+    }
+    std::sort( pending.begin() + oldSize, pending.end(), recordLess );
+    unlock();
+}
+
+
+/** @brief open the log file and start the writer
+  *
+  * @param[in] path Path of the log file, an existing file is overwritten
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the file could not be opened
+**/
+int32_t CCollLog::open( const char* path ) {
+    outFile.open( path, std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( !outFile.is_open() ) {
+        cerr << "ERROR: unable to open \"" << path << "\" for the merge log!" << endl;
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t header[3] = { 0x4c434d47, 2, static_cast<uint32_t>( sizeof( sCollRecord ) ) }; // "GMCL", version, size
+    outFile.write( reinterpret_cast<const char*>( header ), sizeof( header ) );
+
+    try {
+        writing = true;
+        writer  = new sf::Thread( &writeLoop, this );
+        writer->Launch();
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to start the merge log writer! [" << e.what() << "]" << endl;
+        writing = false;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief make sure there is one buffer per thread
+  *
+  * @param[in] numThreads Number of threads that will call record()
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the buffers could not be allocated
+**/
+int32_t CCollLog::prepare( int32_t numThreads ) {
+    if ( static_cast<int32_t>( buffers.size() ) < numThreads ) {
+        try {
+            buffers.resize( numThreads );
+            dropped.resize( numThreads, 0 );
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR: unable to allocate " << numThreads << " merge log buffers! [" << e.what() << "]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/// @brief the writer thread function, writes pending records until the log is destroyed
+void CCollLog::writeLoop( void* aLog ) {
+    CCollLog* log = static_cast<CCollLog*>( aLog );
+
+    while ( log->writing ) {
+        if ( !log->writePending() )
+            pwx_sleep( 50 );
+    }
+}
+
+
+/// @brief write all pending records, returns true if there were any
+bool CCollLog::writePending() {
+    std::vector<sCollRecord> toWrite;
+
+    // Take the records out of pending, so the lock is not held while writing
+    lock();
+    toWrite.swap( pending );
+    unlock();
+
+    if ( toWrite.size() ) {
+        outFile.write( reinterpret_cast<const char*>( toWrite.data() ), toWrite.size() * sizeof( sCollRecord ) );
+        written += toWrite.size();
+        if ( !outFile.good() && writing ) {
+            cerr << "ERROR: writing the merge log failed after " << written << " records!" << endl;
+            writing = false;
+        }
+    }
+
+    return toWrite.size() > 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef PWX_GRAVMAT_COLLLOG_H_INCLUDED
+#define PWX_GRAVMAT_COLLLOG_H_INCLUDED 1
+
+#include <atomic>
+#include <fstream>
+#include <vector>
+
+#include "environment.h"
+
+
+/** @brief One merge as it is written into the log file
+  *
+  * The record is written as it is, in the byte order of the machine. Every
+  * file starts with the magic "GMCL", the format version and the size of one
+  * record, each as a 32 bit unsigned integer, so a reader can check all that.
+  * Version 2 added the time of impact.
+**/
+struct sCollRecord {
+    int64_t  second;      //!< Simulated second the merge happened in
+    uint32_t survivorId;  //!< ID of the unit that took the mass
+    uint32_t destroyedId; //!< ID of the unit that was destroyed
+    double   survivorMass;//!< Mass of the survivor before the merge in kg
+    double   destroyedMass;//!< Mass of the destroyed unit in kg
+    double   posX;        //!< X-Coordinate of the destroyed unit in positional coordinates
+    double   posY;        //!< Y-Coordinate of the destroyed unit in positional coordinates
+    double   posZ;        //!< Z-Coordinate of the destroyed unit in positional coordinates
+    double   velX;        //!< Movement of the destroyed unit relative to the survivor on the X-Axis in m/s
+    double   velY;        //!< Movement of the destroyed unit relative to the survivor on the Y-Axis in m/s
+    double   velZ;        //!< Movement of the destroyed unit relative to the survivor on the Z-Axis in m/s
+    double   toi;         //!< Earliest time of impact of the destroyed unit as the fraction of the last step, 1.0 without --ccd
+};
+
+
+/** @class CCollLog
+  * @brief Append-only binary log of all merges, set with --mergelog
+  *
+  * The merging threads write their records into a buffer of their own, so no
+  * locking is needed there. After each collision check flush() hands all
+  * buffers over to a writer thread, which writes them to disk while the
+  * simulation goes on. The records of one check are sorted by their unit IDs
+  * first, so the log does not depend on which thread merged what.
+**/
+class CCollLog : public pwx::CLockable {
+    std::vector<std::vector<sCollRecord> > buffers; //!< Records of the current check, one buffer per thread
+    std::vector<int64_t>                   dropped; //!< Records per thread that could not be stored
+    std::ofstream                          outFile; //!< The log file
+    std::vector<sCollRecord>               pending; //!< Records waiting for the writer, protected by the lock
+    sf::Thread*                            writer;  //!< Thread that writes the pending records
+    std::atomic<bool>                      writing; //!< The writer runs as long as this is true
+    int64_t                                written; //!< Number of records written so far, only used by the writer
+
+    // The writer thread function, aLog is this log:
+    static void writeLoop( void* aLog );
+
+    // Write all pending records, returns true if there were any:
+    bool writePending();
+
+  public:
+    /// @brief default ctor, the file is opened by open()
+    explicit CCollLog(): writer( NULL ), writing( false ), written( 0 ) { }
+
+    // The dtor stops the writer and writes what is left:
+    ~CCollLog();
+
+    // Hand the records of all threads over to the writer:
+    void    flush();
+
+    // Open the log file and start the writer:
+    int32_t open( const char* path ) PWX_WARNUNUSED;
+
+    // Make sure there is one buffer per thread:
+    int32_t prepare( int32_t numThreads ) PWX_WARNUNUSED;
+
+    /// @brief store @a record in the buffer of thread @a tNum, only that thread may call this
+    void    record( int32_t tNum, const sCollRecord& rec ) {
+        try {
+            buffers[tNum].push_back( rec );
+        } catch ( std::bad_alloc& ) {
+            ++dropped[tNum];
+        }
+    }
+
+  private:
+    /* --- no copying! --- */
+    CCollLog( CCollLog& );
+    CCollLog& operator=( CCollLog& );
+};
+
+#endif // PWX_GRAVMAT_COLLLOG_H_INCLUDED
+
@@ -0,0 +1,185 @@
+#include <algorithm>
+
+#include "collsap.h"
+#include "matter.h"
+
+
+/// @brief order intervals by their lower end
+static bool sapLess( const sSapEntry& lhs, const sSapEntry& rhs ) {
+    return lhs.lo < rhs.lo;
+}
+
+
+/// @brief return the position of @a unit on axis @a aNr
+double CCollSAP::getAxisPos( CMatter* unit, int32_t aNr ) const {
+    return 0 == aNr ? unit->getPosX() : 1 == aNr ? unit->getPosY() : unit->getPosZ();
+}
+
+
+/** @brief fill @a result with the positions of all other units in the sweep that overlap on all three axes
+  *
+  * Units further down the sweep overlap until their lower end passes the upper
+  * end of @a pos. Units before @a pos can not overlap once their lower end is
+  * more than two of the largest extents below the one of @a pos.
+**/
+void CCollSAP::overlaps( int32_t pos, std::vector<int32_t>& result ) const {
+    const std::vector<sSapEntry>& sweep = axis[sweepAxis];
+    const int32_t  maxPos = static_cast<int32_t>( sweep.size() );
+    const int32_t  axisA  = ( sweepAxis + 1 ) % 3;
+    const int32_t  axisB  = ( sweepAxis + 2 ) % 3;
+    const double   loEnd  = sweep[pos].lo;
+    const double   hiEnd  = sweep[pos].hi;
+    const double   loMin  = loEnd - ( 2. * maxExtent );
+    CMatter*       unit   = sweep[pos].unit;
+    const double   posA   = getAxisPos( unit, axisA );
+    const double   posB   = getAxisPos( unit, axisB );
+
+    result.clear();
+
+    for ( int32_t oNr = pos + 1; ( oNr < maxPos ) && !( sweep[oNr].lo > hiEnd ); ++oNr ) {
+        if ( isOverlapping( unit, sweep[oNr].unit, posA, posB, axisA, axisB ) )
+            result.push_back( oNr );
+    }
+
+    for ( int32_t oNr = pos - 1; ( oNr >= 0 ) && !( sweep[oNr].lo < loMin ); --oNr ) {
+        if ( !( sweep[oNr].hi < loEnd ) && isOverlapping( unit, sweep[oNr].unit, posA, posB, axisA, axisB ) )
+            result.push_back( oNr );
+    }
+}
+
+
+/// @brief return true if @a other is not destroyed and overlaps with @a unit on the axes @a axisA and @a axisB
+bool CCollSAP::isOverlapping( CMatter* unit, CMatter* other, double posA, double posB, int32_t axisA, int32_t axisB ) const {
+    // This is the same range as the intervals cover, see refresh()
+    double range = margin * ( unit->getRadius() + other->getRadius() + 1. )
+                   + stepMod * ( unit->getMovement() + other->getMovement() )
+                   + skin;
+    return !other->destroyed()
+           && !( std::abs( posA - getAxisPos( other, axisA ) ) > range )
+           && !( std::abs( posB - getAxisPos( other, axisB ) ) > range );
+}
+
+
+/** @brief drop destroyed units from axis @a aNr and renew the intervals of the others
+  *
+  * See CMatter::destroyed() for why the entries have to be dropped here.
+**/
+void CCollSAP::refresh( int32_t aNr ) {
+    std::vector<sSapEntry>& list  = axis[aNr];
+    size_t                  count = list.size();
+    size_t                  kept  = 0;
+
+    for ( size_t i = 0; i < count; ++i ) {
+        CMatter* unit = list[i].unit;
+        if ( !unit->destroyed() ) {
+            double center = getAxisPos( unit, aNr );
+            double extent = margin * ( unit->getRadius() + 0.5 ) // Two extents add up to the collision range
+                            + stepMod * unit->getMovement()
+                            + skin / 2.;
+            if ( extent > maxExtent )
+                maxExtent = extent;
+            list[kept].lo   = center - extent;
+            list[kept].hi   = center + extent;
+            list[kept].unit = unit;
+            ++kept;
+        }
+    }
+
+    list.resize( kept );
+}
+
+
+/// @brief restore the order of axis @a aNr, which is cheap as long as it is nearly sorted
+void CCollSAP::sortAxis( int32_t aNr ) {
+    std::vector<sSapEntry>& list  = axis[aNr];
+    size_t                  count = list.size();
+
+    for ( size_t i = 1; i < count; ++i ) {
+        if ( list[i].lo < list[i - 1].lo ) {
+            sSapEntry moving = list[i];
+            size_t    j      = i;
+            do {
+                list[j] = list[j - 1];
+                --j;
+            } while ( ( j > 0 ) && ( moving.lo < list[j - 1].lo ) );
+            list[j] = moving;
+        }
+    }
+}
+
+
+/** @brief bring all three axes up to date with the current unit positions
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] units Array of all units in container order
+  * @param[in] count Number of units in @a units
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the lists could not be allocated
+**/
+int32_t CCollSAP::update( ENVIRONMENT* env, CMatter** units, int32_t count ) {
+    assert( env && env->universe && "ERROR: CCollSAP::update() called without valid universe!" );
+
+    margin    = env->universe->M2Pos;
+    maxExtent = 0.;
+    skin      = env->collSkin;
+    stepMod   = env->doSweep ? env->universe->M2Pos * env->secPFmod : 0.;
+
+    // 1.: Count the units that take part, and sum up their spread per axis
+    int32_t alive = 0;
+    double  sum[3]   = { 0., 0., 0. };
+    double  sumSq[3] = { 0., 0., 0. };
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( !units[i]->destroyed() ) {
+            ++alive;
+            for ( int32_t aNr = 0; aNr < 3; ++aNr ) {
+                double pos = getAxisPos( units[i], aNr );
+                sum[aNr]   += pos;
+                sumSq[aNr] += pos * pos;
+            }
+        }
+    }
+
+    // 2.: Drop destroyed units and renew the intervals of all others
+    for ( int32_t aNr = 0; aNr < 3; ++aNr )
+        refresh( aNr );
+
+    // 3.: Units are never added after the initialization. If the numbers differ,
+    //     this is the first run or data has been loaded, and everything is set up anew.
+    if ( static_cast<int32_t>( axis[0].size() ) != alive ) {
+        try {
+            for ( int32_t aNr = 0; aNr < 3; ++aNr ) {
+                axis[aNr].clear();
+                axis[aNr].reserve( alive );
+                for ( int32_t i = 0; i < count; ++i ) {
+                    if ( !units[i]->destroyed() ) {
+                        sSapEntry entry = { 0., 0., units[i] };
+                        axis[aNr].push_back( entry );
+                    }
+                }
+                refresh( aNr );
+                std::sort( axis[aNr].begin(), axis[aNr].end(), sapLess );
+            }
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR: unable to allocate the sweep-and-prune lists for " << alive << " units! [";
+            cerr << e.what() << "]" << endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        for ( int32_t aNr = 0; aNr < 3; ++aNr )
+            sortAxis( aNr );
+    }
+
+    // 4.: The axis with the largest variance separates the units best
+    if ( alive > 0 ) {
+        double maxVar = -1.;
+        for ( int32_t aNr = 0; aNr < 3; ++aNr ) {
+            double mean = sum[aNr] / alive;
+            double var  = ( sumSq[aNr] / alive ) - ( mean * mean );
+            if ( var > maxVar ) {
+                maxVar    = var;
+                sweepAxis = aNr;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
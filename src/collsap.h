@@ -0,0 +1,81 @@
+#pragma once
+#ifndef PWX_GRAVMAT_COLLSAP_H_INCLUDED
+#define PWX_GRAVMAT_COLLSAP_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+
+/// @brief The interval a unit covers on one axis
+struct sSapEntry {
+    double   lo;   //!< Lower end of the interval in positional coordinates
+    double   hi;   //!< Upper end of the interval in positional coordinates
+    CMatter* unit; //!< The unit this interval belongs to
+};
+
+
+/** @class CCollSAP
+  * @brief Incremental sweep-and-prune on three axes as a collision broad-phase
+  *
+  * Every unit covers an interval of its position plus/minus its radius on each
+  * of the three axes. The radii are widened by half a meter, so two intervals
+  * overlap exactly when the units are within the collision range used by
+  * applyCollision(). The intervals are kept sorted by their lower end on all
+  * three axes. With --ccd the intervals are widened by the length of the last
+  * movement step of each unit, so swept collisions are not missed. They are
+  * widened by half the skin thrdCheck() measures the gaps over, too.
+  *
+  * Units move only a little from one second to the next, so the lists stay
+  * nearly sorted and an insertion sort puts them back into order in almost
+  * linear time. Only when the set of units changes in a way the lists can not
+  * follow (the first check, or after loading) are they sorted from scratch.
+  *
+  * The sweep is done along the axis with the largest spread of the units, and
+  * only pairs that overlap on the other two axes, too, are handed out.
+**/
+class CCollSAP {
+    std::vector<sSapEntry> axis[3];   //!< Intervals per axis (0 = X, 1 = Y, 2 = Z) sorted by their lower end
+    double                 margin;    //!< One meter in positional coordinates, see UNIVERSE::M2Pos
+    double                 maxExtent; //!< The largest half interval length, limits the search towards lower ends
+    double                 skin;      //!< Extra range in positional coordinates, see ENVIRONMENT::collSkin
+    double                 stepMod;   //!< Turns a movement into the length of the last step with --ccd, zero otherwise
+    int32_t                sweepAxis; //!< The axis that is swept in overlaps()
+
+    // Return true if other is not destroyed and overlaps with unit on the two axes not swept:
+    bool isOverlapping( CMatter* unit, CMatter* other, double posA, double posB, int32_t axisA, int32_t axisB ) const PWX_WARNUNUSED;
+    // Drop destroyed units from an axis and renew the intervals of the others:
+    void refresh ( int32_t aNr );
+    // Restore the order of an axis that is nearly sorted:
+    void sortAxis( int32_t aNr );
+
+    /// @brief return the position of @a unit on axis @a aNr
+    double getAxisPos( CMatter* unit, int32_t aNr ) const PWX_WARNUNUSED;
+
+  public:
+    /// @brief default ctor, the lists are filled by update()
+    explicit CCollSAP(): margin( 1.0 ), maxExtent( 0.0 ), skin( 0.0 ), stepMod( 0.0 ), sweepAxis( 0 ) { }
+
+    /// @brief default dtor, does nothing.
+    ~CCollSAP() { }
+
+    /// @brief return the unit at position @a pos of the sweep
+    CMatter* getUnit( int32_t pos ) const { return axis[sweepAxis][pos].unit; }
+
+    // Fill result with the positions of all other units in the sweep that overlap on all three axes:
+    void     overlaps( int32_t pos, std::vector<int32_t>& result ) const;
+
+    /// @brief return the number of units in the sweep
+    int32_t  size() const { return static_cast<int32_t>( axis[sweepAxis].size() ); }
+
+    // Bring all three axes up to date with the current unit positions:
+    int32_t  update( ENVIRONMENT* env, CMatter** units, int32_t count ) PWX_WARNUNUSED;
+
+  private:
+    /* --- no copying! --- */
+    CCollSAP( CCollSAP& );
+    CCollSAP& operator=( CCollSAP& );
+};
+
+#endif // PWX_GRAVMAT_COLLSAP_H_INCLUDED
+
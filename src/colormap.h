@@ -209,7 +209,7 @@ class CColorMap : public pwx::CLockable {
 
     ~CColorMap() { /* nothing to be done */ }
 
-    /** @brief The one and only getter method
+    /** @brief The one and only color getter method
       * @param[in] mass The mass in kg
       * @param[in] movZ The current z-movement in m/s
       * @param[in] distZ The distance from the camera in *meters*
@@ -292,6 +292,16 @@ class CColorMap : public pwx::CLockable {
         // Finally we get our target colors:
         WC.getRGB( r, g, b );
     }
+
+    /// @brief return the largest dust radius modifier mkColor() can hand out
+    double getMaxDRMod() const {
+        double maxMod = 1.0; // This is what mkColor() is given, it is kept if no entry fits
+        for ( size_t i = 0; i < size; ++i ) {
+            if ( CD[i].loDR > maxMod ) maxMod = CD[i].loDR;
+            if ( CD[i].upDR > maxMod ) maxMod = CD[i].upDR;
+        }
+        return maxMod;
+    }
 };
 
 
@@ -15,6 +15,53 @@ using pwx::to_int64;
 
 #include "matter.h"
 
+// Local callback to select the collision broad-phase
+void cbCollMode( const char* arg, void* aEnv ) {
+    if ( arg && strlen( arg ) && aEnv ) {
+        ENVIRONMENT* xEnv = reinterpret_cast<ENVIRONMENT*>( aEnv );
+        if      ( STREQ( arg, "bvh"    ) ) xEnv->collMode = ECM_BVH;
+        else if ( STREQ( arg, "grid"   ) ) xEnv->collMode = ECM_GRID;
+        else if ( STREQ( arg, "radial" ) ) xEnv->collMode = ECM_RADIAL;
+        else if ( STREQ( arg, "sap"    ) ) xEnv->collMode = ECM_SAP;
+        else
+            cout << "Warning: Unknown collision mode \"" << arg << "\" ignored." << endl;
+    }
+}
+
+// Local callback to select the dust mode
+void cbDustMode( const char* arg, void* aEnv ) {
+    if ( arg && strlen( arg ) && aEnv ) {
+        ENVIRONMENT* xEnv = reinterpret_cast<ENVIRONMENT*>( aEnv );
+        if      ( STREQ( arg, "insert" ) ) xEnv->dustMode = EDM_INSERT;
+        else if ( STREQ( arg, "sort"   ) ) xEnv->dustMode = EDM_SORT;
+        else
+            cout << "Warning: Unknown dust mode \"" << arg << "\" ignored." << endl;
+    }
+}
+
+// Local callback to select the renderer
+void cbRenderMode( const char* arg, void* aEnv ) {
+    if ( arg && strlen( arg ) && aEnv ) {
+        ENVIRONMENT* xEnv = reinterpret_cast<ENVIRONMENT*>( aEnv );
+        if      ( STREQ( arg, "tiles" ) ) xEnv->renderMode = ERM_TILES;
+        else if ( STREQ( arg, "units" ) ) xEnv->renderMode = ERM_UNITS;
+        else if ( STREQ( arg, "raycast" ) ) xEnv->renderMode = ERM_RAYCAST;
+        else
+            cout << "Warning: Unknown renderer \"" << arg << "\" ignored." << endl;
+    }
+}
+
+// Local callback to select the stream format
+void cbStreamFormat( const char* arg, void* aEnv ) {
+    if ( arg && strlen( arg ) && aEnv ) {
+        ENVIRONMENT* xEnv = reinterpret_cast<ENVIRONMENT*>( aEnv );
+        if      ( STREQ( arg, "y4m"   ) ) xEnv->streamFmt = ESF_Y4M;
+        else if ( STREQ( arg, "rgb24" ) ) xEnv->streamFmt = ESF_RGB24;
+        else
+            cout << "Warning: Unknown stream format \"" << arg << "\" ignored." << endl;
+    }
+}
+
 // Local callback to have one single method to organize the display of help/version
 void cbHelpVersion( const char* arg, void* env ) {
     if ( arg && strlen( arg ) && env ) {
@@ -157,6 +204,10 @@ int32_t processArguments( ENVIRONMENT* env, int argc, char* argv[] ) {
     int32_t FoV       = 90;
 
     // -- normal arguments ---
+    addArgBool  ( "",  "ccd", -2, "Sweep the units along their last movement step, so fast units can not pass through each other", &env->doSweep, ETT_TRUE );
+    addArgCb    ( "",  "collision", -2, "Set the collision broad-phase, \"grid\" (default), \"sap\", \"bvh\" or \"radial\"", 1, "mode", cbCollMode, env );
+    addArgInt32 ( "",  "dust-layers", -2, "Keep at most K dust spheres per pixel, merging the faintest (2-16, implies --dust-mode=sort)", 1, "K", &env->dustLayers, ETT_INT, 2, Max_Dust_Layers );
+    addArgCb    ( "",  "dust-mode", -2, "Set how dust spheres are put together, \"insert\" (default) or \"sort\"", 1, "mode", cbDustMode, env );
     addArgBool  ( "",  "dyncam", -2, "Dynamically move the camera towards the nearest unit, if it is in front of the camera", &env->doDynamic, ETT_TRUE );
     addArgBool  ( "",  "explode", -2, "Matter is not distributed but explodes from the center", &env->explode, ETT_TRUE );
     addArgString( "",  "file", -2, "File to load at program start from and to save on program end into", 1, "path", &env->saveFile, ETT_STRING );
@@ -164,11 +215,22 @@ int32_t processArguments( ENVIRONMENT* env, int argc, char* argv[] ) {
     addArgInt32 ( "",  "fps", -2, "Set FPS between 1 and 200 (default 50)", 1, "FPS", &env->fps, ETT_INT, 1, 200 );
     addArgBool  ( "",  "halfX", -2, "Only create a matter unit for every second X coordinate", &env->doHalfX, ETT_TRUE );
     addArgBool  ( "",  "halfY", -2, "Only create a matter unit for every second Y coordinate", &env->doHalfY, ETT_TRUE );
+    addArgBool  ( "",  "headless", -2, "Open no window, only write the pictures and the progress to stderr", &env->doHeadless, ETT_TRUE );
     addArgInt32 ( "",  "height", -2, "Set window height (minimum 100)", 1, "height", &env->scrHeight, ETT_INT, 100, maxInt32Limit );
     addArgCb    ( "",  "help", -2, "Show this help and exit", 0, NULL, cbHelpVersion, env );
+    addArgDouble( "",  "lod", -2, "Merge units with a view radius below this into one per pixel (0.01-1.0, default off)", 1, "radius", &env->lodRad, ETT_FLOAT, 0.01, 1.0 );
+    addArgBool  ( "",  "pipeline", -2, "Render every picture with a second group of threads while the units move on", &env->doPipeline, ETT_TRUE );
+    addArgCb    ( "",  "renderer", -2, "Set the renderer, \"tiles\" (default), \"units\" or \"raycast\"", 1, "mode", cbRenderMode, env );
+    addArgString( "",  "shm", -2, "Publish all pictures in a ring in this POSIX shared memory instead", 1, "name", &env->shmName, ETT_STRING );
+    addArgInt32 ( "",  "shm-slots", -2, "Set number of pictures the shared memory ring holds (2-64, default 4)", 1, "K", &env->shmSlots, ETT_INT, 2, 64 );
     addArgBool  ( "",  "shockwave", -2, "Matter is distributed in some kind of local shock waves", &env->shockwave, ETT_TRUE );
+    addArgString( "",  "status", -2, "Write the progress into this file once per second instead (implies --headless)", 1, "path", &env->statusFile, ETT_STRING );
+    addArgString( "",  "stream", -2, "Write all pictures into this pipe, FIFO or file instead, \"-\" for stdout", 1, "path", &env->streamPath, ETT_STRING );
+    addArgCb    ( "",  "stream-format", -2, "Set the stream format, \"y4m\" (default) or \"rgb24\"", 1, "format", cbStreamFormat, env );
     addArgCb    ( "",  "version", -2, "Show the programs version and exit", 0, NULL, cbHelpVersion, env );
     addArgInt32 ( "",  "width", -2, "Set window width (minimum 100)", 1, "width", &env->scrWidth, ETT_INT, 100, maxInt32Limit );
+    addArgInt32 ( "",  "writers", -2, "Set number of threads saving the pictures (0-64, default 2)", 1, "num", &env->numWriters, ETT_INT, 0, 64 );
+    addArgString( "",  "mergelog", -2, "Log every merge of two units into this binary file", 1, "path", &env->mergeLog, ETT_STRING );
     addArgString( "o", "outfile", -2, "Format string for the output file. The default is \"outfile_%06d.png\". Supported are bmp, png and jpg.", 1, "pattern", &env->outFileFmt, ETT_STRING );
     addArgInt32 ( "s", "seed", -2, "Set seed", 1, "value", &env->seed, ETT_INT, 0, maxInt32Limit );
     addArgInt32 ( "t", "threads", -2, "Set number of threads (minimum 4, default 8)", 1, "num", &env->numThreads, ETT_INT, 4, maxInt32Limit );
@@ -202,6 +264,21 @@ int32_t processArguments( ENVIRONMENT* env, int argc, char* argv[] ) {
 
     /* First generate values that might overwrite loaded values if set too late */
     env->fov = static_cast<double>( FoV );
+    if ( env->dustLayers > 0 )
+        // The layers are only bounded while the dust spheres are collected
+        env->dustMode = EDM_SORT;
+    if ( env->statusFile.size() )
+        // The status file replaces the window
+        env->doHeadless = true;
+    if ( env->shmName.size() || env->streamPath.size() ) {
+        // The frames must not overtake each other in the shared memory or the stream
+        env->numWriters = 1;
+    }
+    if ( env->streamPath.size() ) {
+        // Nothing else may get into the stream if it goes to stdout
+        if ( STREQ( env->streamPath.c_str(), "-" ) )
+            cout.rdbuf( cerr.rdbuf() );
+    }
     if ( !env->hasUserTime ) {
         if ( env->explode )
             // In explosion mode, the timescale value has a different default:
@@ -300,17 +377,18 @@ int32_t processArguments( ENVIRONMENT* env, int argc, char* argv[] ) {
     // Apply numThreads for the threads and threadPrg numbers:
     if ( EXIT_SUCCESS == result ) {
         try {
-            env->thread    = new sf::Thread*[env->numThreads];
-            env->threadPrg = new int32_t[env->numThreads];
-            env->threadRun = new bool[env->numThreads];
-            for ( int32_t i = 0; i < env->numThreads; ++i ) {
+            int32_t thrdCount = env->getThrdGroups() * env->numThreads;
+            env->thread    = new sf::Thread*[thrdCount];
+            env->threadPrg = new int32_t[thrdCount];
+            env->threadRun = new bool[thrdCount];
+            for ( int32_t i = 0; i < thrdCount; ++i ) {
                 env->thread[i]    = NULL;
                 env->threadPrg[i] = 0;
                 env->threadRun[i] = false;
             }
         } catch ( std::bad_alloc& e ) {
             result = EXIT_FAILURE;
-            cout << "ERROR: unable to allocate " << env->numThreads << " integers for thread progress! [";
+            cout << "ERROR: unable to allocate " << env->getThrdGroups() * env->numThreads << " integers for thread progress! [";
             cout << e.what() << "]" << endl;
         }
     } // End of applying thread data
@@ -376,6 +454,14 @@ void showHelp( ENVIRONMENT* env ) {
     cout << "flow until the escape key is pressed or only one matter unit is left." << endl;
     cout << endl << "  Options:" << endl;
     cout << "x/y/z   <value>             Set offset of the specified dimension." << endl;
+    pwx::args::printArgHelp( cout, "ccd", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "collision", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "dust-layers", spw, lpw, dpw );
+    cout << "   Note: Every pixel then needs at most K dust sphere pixels, no matter how" << endl;
+    cout << "         many dust spheres overlap there." << endl;
+    pwx::args::printArgHelp( cout, "dust-mode", spw, lpw, dpw );
+    cout << "   Note: \"insert\" splits overlapping dust spheres while projecting, \"sort\"" << endl;
+    cout << "         only collects them and resolves all overlaps per pixel when drawing." << endl;
     pwx::args::printArgHelp( cout, "dyncam", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "explode", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "fov", spw, lpw, dpw );
@@ -386,10 +472,26 @@ void showHelp( ENVIRONMENT* env ) {
     cout << "         will be created and the old file overwritten." << endl;
     pwx::args::printArgHelp( cout, "halfX", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "halfY", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "headless", spw, lpw, dpw );
+    cout << "   Note: Nothing is shown and no key is read, the program runs until only" << endl;
+    cout << "         one matter unit is left or it receives SIGINT or SIGTERM." << endl;
     pwx::args::printArgHelp( cout, "height", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "help", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "lod", spw, lpw, dpw );
+    cout << "   Note: Only units at the same pixel and of about the same depth are merged," << endl;
+    cout << "         into one unit with their combined mass and area." << endl;
+    pwx::args::printArgHelp( cout, "mergelog", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "o", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "pipeline", spw, lpw, dpw );
+    cout << "   Note: The units are copied once they are moved, and the copies are drawn" << endl;
+    cout << "         while the next seconds are calculated. This needs twice the threads" << endl;
+    cout << "         and a copy of all units, and a picture shows up one frame later." << endl;
     pwx::args::printArgHelp( cout, "R", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "renderer", spw, lpw, dpw );
+    cout << "   Note: \"tiles\" projects screen tiles in parallel without locking, \"units\"" << endl;
+    cout << "         projects whole units in parallel and locks every dust pixel." << endl;
+    cout << "         \"raycast\" projects nothing, but traces every pixel through a hierarchy" << endl;
+    cout << "         of all units, nearest first, and stops at the first mass." << endl;
     pwx::args::printArgHelp( cout, "s", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "S", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "T", spw, lpw, dpw );
@@ -406,9 +508,29 @@ void showHelp( ENVIRONMENT* env ) {
     pwx::args::printArgHelp( cout, "millennium", spw, lpw, dpw );
     cout << "   Higher time scale factors can be set according to your needs." << endl;
     cout << "   (*): In explosion mode, a day is the default instead of a week." << endl;
+    pwx::args::printArgHelp( cout, "shm", spw, lpw, dpw );
+    cout << "   Note: No picture files are written then. Every slot has a small header" << endl;
+    cout << "         with the picture number, the simulated second and the size, see" << endl;
+    cout << "         shmring.h. Readers wait on a futex or poll, nobody waits for them." << endl;
+    pwx::args::printArgHelp( cout, "shm-slots", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "shockwave", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "status", spw, lpw, dpw );
+    cout << "   Note: The file is overwritten every second with the stats line and the" << endl;
+    cout << "         current message." << endl;
+    pwx::args::printArgHelp( cout, "stream", spw, lpw, dpw );
+    cout << "   Note: No picture files are written then, and exactly one writer thread" << endl;
+    cout << "         writes the frames in order. A FIFO is only opened once a reader" << endl;
+    cout << "         opens it, too. If the reader goes away, the program ends." << endl;
+    pwx::args::printArgHelp( cout, "stream-format", spw, lpw, dpw );
+    cout << "   Note: \"y4m\" is YUV4MPEG2 with 4:2:0 chroma, which ffmpeg and x264 read" << endl;
+    cout << "         directly. \"rgb24\" has no header, the size and rate must be given" << endl;
+    cout << "         to the reader, e.g. \"-f rawvideo -pix_fmt rgb24 -s WxH -r FPS\"." << endl;
     pwx::args::printArgHelp( cout, "version", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "width", spw, lpw, dpw );
+    pwx::args::printArgHelp( cout, "writers", spw, lpw, dpw );
+    cout << "   Note: The pictures are copied and saved while the simulation goes on. If" << endl;
+    cout << "         all writers are busy and 4 pictures per writer wait, the simulation" << endl;
+    cout << "         waits, too. With 0 every picture is saved before going on." << endl;
     pwx::args::printArgHelp( cout, "W", spw, lpw, dpw );
     pwx::args::printArgHelp( cout, "Z", spw, lpw, dpw );
 }
@@ -0,0 +1,106 @@
+#include <new>
+
+#include "dustarena.h"
+
+
+/// @brief the dtor frees all chunks
+CDustArena::~CDustArena() {
+    if ( chunks ) {
+        for ( int32_t cNr = 0; cNr < chunkCnt; ++cNr ) {
+            sDustPixel* chunk = chunks[cNr].load();
+            if ( chunk )
+                ::operator delete( chunk, std::align_val_t( Cache_Line ) );
+        }
+        delete [] chunks;
+        chunks = NULL;
+    }
+}
+
+
+/** @brief take one pixel out of the arena
+  *
+  * The pixel is invalidated and has no next. If its chunk is used for the first
+  * time, the chunk is allocated, which throws std::bad_alloc if that fails.
+  *
+  * @return the pixel or NULL if the arena is full
+**/
+sDustPixel* CDustArena::alloc() {
+    int64_t idx = used.fetch_add( 1, std::memory_order_relaxed );
+
+    if ( idx >= capacity() ) {
+        dropped.fetch_add( 1, std::memory_order_relaxed );
+        return NULL;
+    }
+
+    int32_t     cNr   = static_cast<int32_t>( idx >> chunkBits );
+    sDustPixel* chunk = chunks[cNr].load( std::memory_order_acquire );
+
+    if ( NULL == chunk ) {
+        lock();
+        try {
+            // Another thread might have been faster:
+            chunk = chunks[cNr].load( std::memory_order_relaxed );
+            if ( NULL == chunk ) {
+                void* buf = ::operator new( chunkSize * sizeof( sDustPixel ), std::align_val_t( Cache_Line ) );
+                chunk = static_cast<sDustPixel*>( buf );
+                for ( int32_t i = 0; i < chunkSize; ++i )
+                    new ( chunk + i ) sDustPixel();
+                chunks[cNr].store( chunk, std::memory_order_release );
+            }
+        } catch ( std::bad_alloc& ) {
+            unlock();
+            throw;
+        }
+        unlock();
+    }
+
+    sDustPixel* result = chunk + ( idx & ( chunkSize - 1 ) );
+    // The slot might still hold a pixel of an earlier frame:
+    result->invalidate();
+    result->next = NULL;
+
+    return result;
+}
+
+
+/** @brief allocate the chunk table for at most @a maxPixels pixels
+  *
+  * The chunks themselves are allocated by alloc() when they are first needed.
+  *
+  * @param[in] maxPixels Maximum number of pixels, rounded up to full chunks
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the table could not be allocated
+**/
+int32_t CDustArena::init( int64_t maxPixels ) {
+    chunkCnt = static_cast<int32_t>( ( maxPixels + chunkSize - 1 ) >> chunkBits );
+
+    try {
+        chunks = new std::atomic<sDustPixel*>[chunkCnt];
+        for ( int32_t cNr = 0; cNr < chunkCnt; ++cNr )
+            chunks[cNr].store( NULL );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << chunkCnt << " dust arena chunks! [" << e.what() << "]" << endl;
+        chunkCnt = 0;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief free all pixels at once
+  *
+  * This must only be called after thrdDraw() has cut all chains off the roots
+  * in the zDustMap, and while no thread projects anything.
+**/
+void CDustArena::reset() {
+    int64_t last = used.load();
+
+    if ( last > capacity() )
+        last = capacity();
+    if ( last > peak )
+        peak = last;
+
+    used.store( 0 );
+    dropped.store( 0 );
+}
+
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef PWX_GRAVMAT_DUSTARENA_H_INCLUDED
+#define PWX_GRAVMAT_DUSTARENA_H_INCLUDED 1
+
+#include <atomic>
+
+#include "environment.h"
+#include "dustpixel.h"
+
+/// @brief Average number of chained dust sphere pixels the arena holds per pixel of the plane
+const int32_t Dust_Arena_Per_Pixel = 4;
+
+
+/** @class CDustArena
+  * @brief Per-frame storage for the dust sphere pixels chained behind the zDustMap
+  *
+  * The zDustMap only holds the root of every dust sphere chain. Every further
+  * dust sphere pixel is taken from this arena, which hands out the next free
+  * slot of a chunk of pixels. The index of the next free slot is an atomic
+  * counter, so the tile threads can take pixels without any locking. Only
+  * when a chunk is used for the first time is it allocated under the lock.
+  *
+  * Once thrdDraw() has cut all chains off the roots, reset() frees all pixels
+  * at once by setting the counter back to zero. The chunks are kept and
+  * reused by the next frame, so allocation stops after the first few frames.
+  *
+  * The arena holds at most a fixed number of pixels. When it is full, alloc()
+  * returns NULL and the dust sphere is dropped for this frame. The status line
+  * shows the peak use and how many pixels the last frame has dropped.
+**/
+class CDustArena : public pwx::CLockable {
+    std::atomic<sDustPixel*>* chunks;   //!< Table of all chunks, those not used so far are NULL
+    int32_t                   chunkCnt; //!< Number of entries in chunks
+    std::atomic<int64_t>      dropped;  //!< Number of pixels that did not fit into the arena in this frame
+    int64_t                   peak;     //!< Largest number of pixels a frame has used so far
+    std::atomic<int64_t>      used;     //!< Index of the next free slot, might grow beyond the capacity
+
+  public:
+    static const int32_t chunkBits = 12;              //!< A chunk holds 2^chunkBits pixels
+    static const int32_t chunkSize = 1 << chunkBits; //!< Number of pixels in one chunk
+
+    /// @brief default ctor, the table is allocated by init()
+    explicit CDustArena(): chunks( NULL ), chunkCnt( 0 ), dropped( 0 ), peak( 0 ), used( 0 ) { }
+
+    // The dtor frees all chunks:
+    ~CDustArena();
+
+    // Take one pixel, NULL if the arena is full:
+    sDustPixel* alloc() PWX_WARNUNUSED;
+
+    /// @brief return the maximum number of pixels the arena can hold
+    int64_t     capacity() const { return static_cast<int64_t>( chunkCnt ) << chunkBits; }
+
+    /// @brief return the number of pixels that were dropped in the current frame
+    int64_t     getDropped() const { return dropped.load( std::memory_order_relaxed ); }
+
+    /// @brief return the largest number of pixels a frame has used so far
+    int64_t     getPeak() const { return peak; }
+
+    // Allocate the chunk table for at most maxPixels pixels:
+    int32_t     init( int64_t maxPixels ) PWX_WARNUNUSED;
+
+    // Free all pixels at once, no chain may reference them any more:
+    void        reset();
+
+  private:
+    /* --- no copying! --- */
+    CDustArena( CDustArena& );
+    CDustArena& operator=( CDustArena& );
+};
+
+#endif // PWX_GRAVMAT_DUSTARENA_H_INCLUDED
+
@@ -0,0 +1,63 @@
+#include <algorithm>
+
+#include "dustblend.h"
+
+
+/** @brief blend all layers of all lanes
+  *
+  * Every color becomes ( color * ( blendOne - opacity ) + part * opacity )
+  * divided by blendOne, rounded. The sums stay below 2^31, as every color is
+  * at most 255. Afterwards all opacities are zero again, so the next batch
+  * finds only empty layers.
+**/
+void CDustBlend::blend() {
+    // Local copies can not alias the layers, so the compiler is free to vectorize the lanes
+    uint32_t cR[lanes], cG[lanes], cB[lanes];
+    std::copy( outR, outR + lanes, cR );
+    std::copy( outG, outG + lanes, cG );
+    std::copy( outB, outB + lanes, cB );
+
+    for ( int32_t layer = 0; layer < maxDepth; ++layer ) {
+        const uint32_t* lR = &layR[static_cast<size_t>( layer ) * lanes];
+        const uint32_t* lG = &layG[static_cast<size_t>( layer ) * lanes];
+        const uint32_t* lB = &layB[static_cast<size_t>( layer ) * lanes];
+        const uint32_t* lA = &layA[static_cast<size_t>( layer ) * lanes];
+
+        for ( int32_t lane = 0; lane < lanes; ++lane ) {
+            uint32_t opac   = lA[lane];
+            uint32_t transp = blendOne - opac;
+            cR[lane] = ( ( cR[lane] * transp ) + ( lR[lane] * opac ) + blendHalf ) >> blendShift;
+            cG[lane] = ( ( cG[lane] * transp ) + ( lG[lane] * opac ) + blendHalf ) >> blendShift;
+            cB[lane] = ( ( cB[lane] * transp ) + ( lB[lane] * opac ) + blendHalf ) >> blendShift;
+        }
+    }
+
+    std::copy( cR, cR + lanes, outR );
+    std::copy( cG, cG + lanes, outG );
+    std::copy( cB, cB + lanes, outB );
+    std::fill( layA.begin(), layA.begin() + ( static_cast<size_t>( maxDepth ) * lanes ), 0 );
+}
+
+
+/** @brief make room for one more layer
+  *
+  * The new layer is empty in all lanes.
+  *
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the layer could not be allocated
+**/
+int32_t CDustBlend::grow() {
+    size_t newSize = layA.size() + lanes;
+
+    try {
+        layR.resize( newSize, 0 );
+        layG.resize( newSize, 0 );
+        layB.resize( newSize, 0 );
+        layA.resize( newSize, 0 );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << ( newSize / lanes ) << " dust sphere layers! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef PWX_GRAVMAT_DUSTBLEND_H_INCLUDED
+#define PWX_GRAVMAT_DUSTBLEND_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+
+/** @class CDustBlend
+  * @brief Blends the dust sphere chains of several pixels at once in fixed point
+  *
+  * thrdDraw() takes the pixels of a row in batches of @a lanes. The mass
+  * color of every pixel is set with setBase(), then the drawable dust sphere
+  * parts of its chain are added with add(), in the order blendDust() would
+  * get them. blend() then puts all pixels of the batch together layer
+  * by layer. A pixel with a shorter chain gets empty layers, which leave its
+  * color as it is, so the inner loop over the lanes has no branches and is
+  * vectorized by the compiler.
+  *
+  * The opacity of a part is stored as a fraction of blendOne, which is
+  * precise enough to keep every color within one of what blendDust() would
+  * have calculated. Parts that blendDust() regards as opaque get blendOne.
+  *
+  * Every drawing thread needs its own CDustBlend.
+**/
+class CDustBlend {
+  public:
+    static const int32_t  lanes      = 8;                        //!< Number of pixels blended at once
+    static const int32_t  blendShift = 23;                       //!< Bits after the binary point of the opacities
+    static const uint32_t blendOne   = 1U << blendShift;         //!< Opacity of an opaque dust sphere part
+    static const uint32_t blendHalf  = 1U << ( blendShift - 1 ); //!< Added before shifting, so the colors are rounded
+
+  private:
+    std::vector<uint32_t> layR;        //!< Red part of the dust sphere parts, layer by layer, lanes per layer
+    std::vector<uint32_t> layG;        //!< Green part of the dust sphere parts
+    std::vector<uint32_t> layB;        //!< Blue part of the dust sphere parts
+    std::vector<uint32_t> layA;        //!< Opacity of the dust sphere parts, zero for empty layers
+    int32_t               depth[lanes];//!< Number of layers of every lane
+    int32_t               maxDepth;    //!< Number of layers of the deepest lane
+    uint32_t              outR[lanes]; //!< Red part of every pixel, the mass color until blend() is done
+    uint32_t              outG[lanes]; //!< Green part of every pixel
+    uint32_t              outB[lanes]; //!< Blue part of every pixel
+
+    // Make room for one more layer:
+    int32_t grow() PWX_WARNUNUSED;
+
+  public:
+    /// @brief default ctor, the layers are allocated by add()
+    explicit CDustBlend(): maxDepth( 0 ) {
+        start();
+    }
+
+    /// @brief default dtor, does nothing.
+    ~CDustBlend() { }
+
+    /** @brief add a dust sphere part to @a lane, it is blended over everything added before
+      *
+      * Like blendDust(), a part with less than 0.5% transparency is opaque and
+      * overwrites the color.
+      *
+      * @param[in] lane The pixel of the batch
+      * @param[in] r Red part of the dust sphere color
+      * @param[in] g Green part of the dust sphere color
+      * @param[in] b Blue part of the dust sphere color
+      * @param[in] opacity Range of the part divided by the maximum range of its dust sphere
+      * @return EXIT_SUCCESS or EXIT_FAILURE if the layer could not be allocated
+    **/
+    int32_t add( int32_t lane, uint8_t r, uint8_t g, uint8_t b, double opacity ) PWX_WARNUNUSED {
+        int32_t layer = depth[lane];
+
+        if ( layer == maxDepth ) {
+            if ( ( static_cast<size_t>( layer + 1 ) * lanes > layA.size() ) && ( EXIT_FAILURE == grow() ) )
+                return EXIT_FAILURE;
+            maxDepth = layer + 1;
+        }
+
+        size_t idx = ( static_cast<size_t>( layer ) * lanes ) + lane;
+        layR[idx] = r;
+        layG[idx] = g;
+        layB[idx] = b;
+        // The opacity is positive, so adding one half rounds it like std::round() does
+        layA[idx] = ( ( 1.0 - opacity ) > 0.005 )
+                    ? static_cast<uint32_t>( ( opacity * static_cast<double>( blendOne ) ) + 0.5 )
+                    : blendOne;
+        depth[lane] = layer + 1;
+
+        return EXIT_SUCCESS;
+    }
+
+    // Blend all layers of all lanes:
+    void    blend();
+
+    /// @brief return the color of the pixel in @a lane, blend() must have been called
+    void    getColor( int32_t lane, uint8_t& r, uint8_t& g, uint8_t& b ) const {
+        r = static_cast<uint8_t>( outR[lane] );
+        g = static_cast<uint8_t>( outG[lane] );
+        b = static_cast<uint8_t>( outB[lane] );
+    }
+
+    /// @brief set the color of the pixel in @a lane the dust sphere parts are blended over
+    void    setBase( int32_t lane, uint8_t r, uint8_t g, uint8_t b ) {
+        outR[lane] = r;
+        outG[lane] = g;
+        outB[lane] = b;
+    }
+
+    /// @brief start a new batch, all lanes are black and have no layers
+    void    start() {
+        for ( int32_t lane = 0; lane < lanes; ++lane ) {
+            depth[lane] = 0;
+            outR[lane]  = 0;
+            outG[lane]  = 0;
+            outB[lane]  = 0;
+        }
+        maxDepth = 0;
+    }
+
+  private:
+    /* --- no copying! --- */
+    CDustBlend( CDustBlend& );
+    CDustBlend& operator=( CDustBlend& );
+};
+
+#endif // PWX_GRAVMAT_DUSTBLEND_H_INCLUDED
+
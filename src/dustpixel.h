@@ -2,6 +2,8 @@
 #ifndef GRAVMAT_DUSTPIXEL_H_INCLUDED
 #define GRAVMAT_DUSTPIXEL_H_INCLUDED 1
 
+#include <cmath>
+
 #include "masspixel.h"
 
 /* Note on minimum dust sphere ranges:
@@ -29,7 +31,8 @@ const double Min_Dust_Range = Min_Dust_MaxRange / 255.; // Any range below this
   * This simple struct derives from sMassPixel and adds a pointer to
   * allow chains of dust sphere pixels that are ordered by their z position.
   * Additionally thickness of the dust sphere at this position and its opacity
-  * are recorded.
+  * are recorded. Only the root of each chain lives in the zDustMap, all
+  * further pixels are taken from the CDustArena and only last for one frame.
   *
   * The dust sphere pixels are stored as a "blind backside queue". This means, that
   * the queue is filled from back to front, only adding new dust sphere pixels if
@@ -63,12 +66,6 @@ struct sDustPixel : public sMassPixel {
     explicit sDustPixel(): sMassPixel(), range( -1.0 ), maxRange( 0.0 ), next( NULL )
     { /* nothing to be done here */ }
 
-    /// @brief dtor that deletes the whole chain!
-    ~sDustPixel() {
-        if ( next )
-            delete next; // It will delete its next and that its next and so on.
-    } // End of dtor
-
     /// @brief Invalidate it all
     void invalidate() {
         sMassPixel::invalidate();
@@ -108,5 +105,85 @@ struct sDustPixel : public sMassPixel {
     }
 };
 
+
+/** @brief One dust sphere part as it is collected by ENVIRONMENT::resolveDust()
+  *
+  * With --dust-mode=sort the chains are not ordered and the dust spheres in
+  * them may overlap. They are copied into these fragments, which are then
+  * sorted by their far end, see sortDustFrag().
+**/
+struct sDustFrag {
+    double  z;        //!< Near end of the fragment
+    double  end;      //!< Far end of the fragment, which is z + range
+    double  maxRange; //!< maximum range of the full dust sphere
+    uint8_t r;        //!< Red value of this fragments color
+    uint8_t g;        //!< Green value of this fragments color
+    uint8_t b;        //!< Blue value of this fragments color
+};
+
+
+/// @brief order dust fragments from the far end to the near end, ties are broken by all other values
+inline bool sortDustFrag( const sDustFrag& lhs, const sDustFrag& rhs ) {
+    if ( lhs.end      != rhs.end )      return lhs.end      > rhs.end;
+    if ( lhs.z        != rhs.z )        return lhs.z        > rhs.z;
+    if ( lhs.maxRange != rhs.maxRange ) return lhs.maxRange > rhs.maxRange;
+    if ( lhs.r        != rhs.r )        return lhs.r        > rhs.r;
+    if ( lhs.g        != rhs.g )        return lhs.g        > rhs.g;
+    return lhs.b > rhs.b;
+}
+
+
+/** @brief blend a dust sphere part with an opacity of @a opacity over the color @a r, @a g, @a b
+  *
+  * Dust sphere parts with less than 0.5% transparency are considered to be
+  * completely opaque and simply overwrite the color.
+**/
+inline void blendDust( uint8_t& r, uint8_t& g, uint8_t& b, uint8_t dR, uint8_t dG, uint8_t dB, double opacity ) {
+    double transp = 1.0 - opacity;
+
+    if ( transp > 0.005 ) {
+        // The dust sphere is transparent enough, calculate the color
+        r = static_cast<uint8_t>( std::round( ( static_cast<double>( r ) * transp )
+                                             +( static_cast<double>( dR ) * opacity ) ) );
+        g = static_cast<uint8_t>( std::round( ( static_cast<double>( g ) * transp )
+                                             +( static_cast<double>( dG ) * opacity ) ) );
+        b = static_cast<uint8_t>( std::round( ( static_cast<double>( b ) * transp )
+                                             +( static_cast<double>( dB ) * opacity ) ) );
+    } else {
+        // The dust sphere is opaque, overwrite our colors with the dust sphere colors
+        r = dR;
+        g = dG;
+        b = dB;
+    }
+}
+
+
+/** @brief merge two dust sphere parts that share the range @a spRange
+  *
+  * Part A has the maximum range @a maxA and the color @a rA, @a gA, @a bA,
+  * part B has @a maxB and @a rB, @a gB, @a bB. The colors are weighted by
+  * the maximum ranges and written into @a r, @a g and @a b. These are not
+  * limited to 255, the caller has to take care of that.
+  *
+  * @return the maximum range of the merged part
+**/
+inline double mergeDustParts( double spRange,
+                              double maxA, uint8_t rA, uint8_t gA, uint8_t bA,
+                              double maxB, uint8_t rB, uint8_t gB, uint8_t bB,
+                              int32_t& r, int32_t& g, int32_t& b ) {
+    double opacityA  = maxA / spRange;
+    double opacityB  = maxB / spRange;
+    double spOpacity = opacityA + opacityB;
+
+    r = static_cast<uint32_t>(  std::round( static_cast<double>( rA ) * ( opacityA / spOpacity ) )
+                                + std::round( static_cast<double>( rB ) * ( opacityB / spOpacity ) ) );
+    g = static_cast<uint32_t>(  std::round( static_cast<double>( gA ) * ( opacityA / spOpacity ) )
+                                + std::round( static_cast<double>( gB ) * ( opacityB / spOpacity ) ) );
+    b = static_cast<uint32_t>(  std::round( static_cast<double>( bA ) * ( opacityA / spOpacity ) )
+                                + std::round( static_cast<double>( bB ) * ( opacityB / spOpacity ) ) );
+
+    return spRange / spOpacity;
+}
+
 #endif // GRAVMAT_DUSTPIXEL_H_INCLUDED
 
@@ -6,6 +6,32 @@
 // Here the real pixel info headers have to be included
 #include "dustpixel.h" // It will pull masspixel.h in
 
+// The collision broad-phase and merge graph are created by initSFML(), but deleted here:
+#include "collbvh.h"
+#include "collgraph.h"
+#include "collgrid.h"
+#include "colllog.h"
+#include "collsap.h"
+
+// The same applies to the tile bins, the ray casting hierarchy, the coarse depth of the masses and the LOD merging:
+#include "hizmap.h"
+#include "lodmap.h"
+#include "raybvh.h"
+#include "tilebins.h"
+
+// The dust arena and the sphere profiles are created by initZMaps():
+#include "dustarena.h"
+#include "spherelut.h"
+
+// The picture writers are created by initSFML(), too:
+#include "framewriter.h"
+
+// Needed for the aligned zMaps:
+#include <new>
+
+// Needed for sorting the dust fragments:
+#include <algorithm>
+
 // Needed for loading and saving:
 #include <fstream>
 #include <pwxStreamHelpers.h>
@@ -18,30 +44,31 @@ const char* ENVIRONMENT::getVersion() const {
 
 /** @brief Default constructor **/
 ENVIRONMENT::ENVIRONMENT ( int32_t aSeed ) :
-    camDist ( 0. ), colorMap ( NULL ), currFrame ( 0 ), cyclPerFrm ( 1. / 50. ),
-    doDynamic ( false ), doHalfX ( false ), doHalfY ( false ), doPause ( false ),
-    doVideo ( false ), doWork ( true ), drawDust ( false ), dynMaxZ ( 1000.0 ),
+    camDist ( 0. ), collBvh ( NULL ), collGate ( false ), collGraph ( NULL ), collGrid ( NULL ), collLog ( NULL ), collMode ( ECM_GRID ), collSap ( NULL ), collSkin ( 0. ), colorMap ( NULL ), currFrame ( 0 ), cyclPerFrm ( 1. / 50. ),
+    doDynamic ( false ), doHalfX ( false ), doHalfY ( false ), doHeadless ( false ), doPause ( false ), doPipeline ( false ), doSweep ( false ),
+    doVideo ( false ), doWork ( true ), drawDust ( false ), dustArena ( NULL ), dustLayers ( 0 ), dustMode ( EDM_INSERT ), dynMaxZ ( 1000.0 ),
     elaDay ( 0 ), elaHour ( 0 ), elaMin ( 0 ), elaSec ( 0 ), elaYear (),
     explode ( false ), fileVersion ( 5 ),
-    font ( NULL ), fontSize ( 12.f ), fov ( 90. ), fps ( 50 ),
-    halfHeight ( 200.0 ), halfWidth ( 200.0 ), hasUserTime ( false ),
+    font ( NULL ), fontSize ( 12.f ), fov ( 90. ), fps ( 50 ), frameBuf (), frameWriter ( NULL ),
+    halfHeight ( 200.0 ), halfWidth ( 200.0 ), hasUserTime ( false ), hiZMap ( NULL ),
 #if defined(PWX_HAS_CXX11_INIT)
     image( {} ),
 #endif
-       initFinished ( false ), isLoaded ( false ),
-       minZ ( 1000.0 ), maxZ ( 1000.0 ),
-       numThreads ( 8 ), offX ( 0.0 ), offY ( 0.0 ), offZ ( 0.0 ), outFileFmt ( "outfile_%06d.png" ),
-       picNum ( 0 ), saveFile ( "" ), screen ( NULL ), scrHeight ( 400 ), scrWidth ( 400 ),
+       initFinished ( false ), isLoaded ( false ), lodMap ( NULL ), lodRad ( 0. ),
+       minZ ( 1000.0 ), maxZ ( 1000.0 ), mergeLog ( "" ),
+       numThreads ( 8 ), numWriters ( 2 ), offX ( 0.0 ), offY ( 0.0 ), offZ ( 0.0 ), outFileFmt ( "outfile_%06d.png" ),
+       picNum ( 0 ), rayBvh ( NULL ), renderMode ( ERM_TILES ), saveFile ( "" ), screen ( NULL ), scrHeight ( 400 ), scrWidth ( 400 ),
        secondsDone( 0 ), secPerCycle( 604800 ), secPerFrame( NULL ),
        secPFmod( 6.048e5 / static_cast<double>( fps ) ),
-       seed ( aSeed ), shockwave ( false ),
+       seed ( aSeed ), shmName ( "" ), shmSlots ( 4 ), shockwave ( false ), sphereLut ( NULL ),
        spxRedu ( 1.667 ), spxSmoo ( 1.337 ), spxWave ( 5 ), spxZoom ( 29.7633 ),
 #if defined(PWX_HAS_CXX11_INIT)
        statClock( {} ),
 #endif
-       statCurrMove ( 0. ), statDone ( 0 ), statMaxAccel ( 0. ), statMaxMove ( 0. ),
-       statMaxWidth ( 200 ), statTimeEla ( 0. ),
-       thread ( NULL ), threadPrg ( NULL ), threadRun ( NULL ),
+       statCollCand ( 0 ), statCollMerge ( 0 ), statCollSkip ( 0 ), statCollSwept ( 0 ),
+       statCurrMove ( 0. ), statDone ( 0 ), statDustDrop ( 0 ), statHidden ( 0 ), statLodMerged ( 0 ), statMaxAccel ( 0. ), statMaxMove ( 0. ),
+       statMaxWidth ( 200 ), statTimeEla ( 0. ), statusFile ( "" ), streamFmt ( ESF_Y4M ), streamPath ( "" ),
+       thread ( NULL ), threadPrg ( NULL ), threadRun ( NULL ), tileBins ( NULL ),
        universe( NULL ),
        zDustMap ( NULL ), zMassMap ( NULL ),
 version ( "0.8.6" ) {
@@ -58,8 +85,9 @@ ENVIRONMENT::~ENVIRONMENT() {
 
     // Be dead safe about our threads _first_!
     if ( thread ) {
-        clearThreads();
-        for ( int32_t tNum = 0; tNum < numThreads; ++tNum ) {
+        for ( int32_t group = 0; group < getThrdGroups(); ++group )
+            clearThreads( group );
+        for ( int32_t tNum = 0; tNum < getThrdGroups() * numThreads; ++tNum ) {
             if ( thread[tNum] ) {
                 delete thread[tNum];
                 thread[tNum]    = NULL;
@@ -71,42 +99,64 @@ ENVIRONMENT::~ENVIRONMENT() {
     // Then clear the rest:
     if ( screen )      { delete    screen; }
     if ( font )        { delete    font; }
+    if ( collBvh )     { delete    collBvh; }
+    if ( collGraph )   { delete    collGraph; }
+    if ( collGrid )    { delete    collGrid; }
+    if ( collLog )     { delete    collLog; }
+    if ( collSap )     { delete    collSap; }
     if ( colorMap )    { delete    colorMap; }
+    if ( dustArena )   { delete    dustArena; }
+    if ( frameWriter ) { delete    frameWriter; }
+    if ( hiZMap )      { delete    hiZMap; }
+    if ( lodMap )      { delete    lodMap; }
+    if ( rayBvh )      { delete    rayBvh; }
     if ( secPerFrame ) { delete [] secPerFrame; }
+    if ( sphereLut )   { delete    sphereLut; }
     if ( threadPrg )   { delete [] threadPrg; }
     if ( threadRun )   { delete [] threadRun; }
+    if ( tileBins )    { delete    tileBins; }
     if ( universe )    { delete    universe;  }
     if ( zDustMap ) {
-        for ( int32_t x = 0; x < scrWidth; ++x ) {
-            if ( zDustMap[x] ) {
-                delete [] zDustMap[x];
-            }
-        }
+        // The chains belong to the dust arena, the pixels have nothing to destroy
+        if ( zDustMap[0] )
+            ::operator delete( zDustMap[0], std::align_val_t( Cache_Line ) );
         delete [] zDustMap;
     }
     if ( zMassMap ) {
-        for ( int32_t x = 0; x < scrWidth; ++x ) {
-            if ( zMassMap[x] ) {
-                delete [] zMassMap[x];
-            }
-        }
+        if ( zMassMap[0] )
+            ::operator delete( zMassMap[0], std::align_val_t( Cache_Line ) );
         delete [] zMassMap;
     }
 
     screen      = NULL;
     font        = NULL;
+    collBvh     = NULL;
+    collGraph   = NULL;
+    collGrid    = NULL;
+    collLog     = NULL;
+    collSap     = NULL;
     colorMap    = NULL;
+    dustArena   = NULL;
+    frameWriter = NULL;
+    hiZMap      = NULL;
+    lodMap      = NULL;
+    rayBvh      = NULL;
     secPerFrame = NULL;
+    sphereLut   = NULL;
     thread      = NULL;
     threadPrg   = NULL;
     threadRun   = NULL;
+    tileBins    = NULL;
 
 }
 
 
-/// @brief simple function that finishes and clears all threads
-void ENVIRONMENT::clearThreads() {
-    for ( int32_t tNum = 0; tNum < numThreads; ++tNum ) {
+/** @brief simple function that finishes and clears all threads of a group
+  *
+  * @param[in] group The group of threads, 1 is the renderer with --pipeline
+**/
+void ENVIRONMENT::clearThreads( int32_t group ) {
+    for ( int32_t tNum = group * numThreads; tNum < ( group + 1 ) * numThreads; ++tNum ) {
         if ( threadRun[tNum] && thread[tNum] ) {
             thread[tNum]->Wait();
         }
@@ -121,6 +171,49 @@ void ENVIRONMENT::clearThreads() {
 }
 
 
+/** @brief add a dust sphere to the chain of a pixel without looking at the others
+  *
+  * With EDM_SORT the chains are neither ordered nor free of overlaps. The root
+  * takes the first dust sphere, all others are put right behind it. They are
+  * sorted and put together by resolveDust() when drawing.
+  *
+  * With --dust-layers a chain never grows beyond dustLayers pixels. Once it is
+  * full, the faintest dust sphere is merged into another, see mergeDustLayer().
+**/
+int32_t ENVIRONMENT::appendDust( int32_t x, int32_t y, double z, uint8_t r, uint8_t g, uint8_t b, double range, double maxRange ) {
+    int32_t     result = EXIT_SUCCESS;
+    sDustPixel* root   = &zDustMap[y][x];
+    int32_t     layers = 0;
+
+    if ( dustLayers > 0 ) {
+        for ( sDustPixel* dust = root; dust; dust = dust->next )
+            ++layers;
+    }
+
+    if ( root->z < -1.5 )
+        root->setAll( z, r, g, b, range, maxRange );
+    else if ( ( dustLayers > 0 ) && ( layers >= dustLayers ) )
+        mergeDustLayer( x, y, z, r, g, b, range, maxRange );
+    else {
+        try {
+            sDustPixel* newDust = dustArena->alloc();
+            // If the arena is full, this dust sphere is dropped for this frame
+            if ( newDust ) {
+                newDust->setAll( z, r, g, b, range, maxRange );
+                newDust->next = root->next;
+                root->next    = newDust;
+            }
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR : Unable to generate a new dust sphere pixel \n";
+            cerr << "Reason: " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    return result;
+}
+
+
 /// @brief return a dust sphere pixel with a lower or equal z which is the last or has a next with higher z than given
 sDustPixel* ENVIRONMENT::findPrevDust ( sDustPixel* start, double z ) {
     sDustPixel* result = start;
@@ -142,7 +235,7 @@ sDustPixel* ENVIRONMENT::findPrevDust ( sDustPixel* start, double z ) {
   * to -2 if this invalidates all dust spheres in the queue.
 **/
 void ENVIRONMENT::invalidateDustSpheres( int32_t x, int32_t y, double z ) {
-    sDustPixel* curr = &zDustMap[x][y];
+    sDustPixel* curr = &zDustMap[y][x];
 
     if ( curr->z > -1.5 ) {
         while ( curr && ( ( curr->z < 0. ) || ( curr->z >= z ) ) ) {
@@ -153,7 +246,7 @@ void ENVIRONMENT::invalidateDustSpheres( int32_t x, int32_t y, double z ) {
 
         // If the queue is completely invalidated, we note this fact in the root dust sphere:
         if ( NULL == curr )
-            zDustMap[x][y].z = -2.0;
+            zDustMap[y][x].z = -2.0;
         else if ( ( curr->z > 0. ) && ( ( curr->z + curr->range ) > z ) ) {
             curr->range = z - curr->z;
             // It might be that this dust sphere is reduced to a too small size:
@@ -165,9 +258,83 @@ void ENVIRONMENT::invalidateDustSpheres( int32_t x, int32_t y, double z ) {
 }
 
 
+/** @brief merge the faintest dust sphere of a full pixel into its nearest neighbour
+  *
+  * The new dust sphere and all in the chain are candidates. The one with the
+  * lowest opacity is merged into the one it overlaps most, or which is nearest
+  * if it overlaps none. The merged dust sphere covers both, and gets its color
+  * and maximum range by the arithmetic splitDust() uses for overlapping parts.
+  * The node freed by the merge takes the new dust sphere, so the chain keeps
+  * its length.
+**/
+void ENVIRONMENT::mergeDustLayer( int32_t x, int32_t y, double z, uint8_t r, uint8_t g, uint8_t b, double range, double maxRange ) {
+    sDustPixel  fresh;
+    sDustPixel* cand[Max_Dust_Layers + 1];
+    int32_t     count = 0;
+
+    fresh.setAll( z, r, g, b, range, maxRange );
+
+    for ( sDustPixel* dust = &zDustMap[y][x]; dust && ( count < Max_Dust_Layers ); dust = dust->next )
+        cand[count++] = dust;
+    cand[count++] = &fresh;
+
+    // 1.: Find the faintest dust sphere, invalidated ones are the faintest of all
+    int32_t least   = 0;
+    double  leastOp = 2.;
+    for ( int32_t cNr = 0; cNr < count; ++cNr ) {
+        double opacity = cand[cNr]->z > 0. ? cand[cNr]->range / cand[cNr]->maxRange : -1.;
+        if ( opacity < leastOp ) {
+            least   = cNr;
+            leastOp = opacity;
+        }
+    }
+
+    sDustPixel* faint = cand[least];
+    if ( faint->z > 0. ) {
+        // 2.: Find the neighbour it overlaps most or is nearest to
+        int32_t nearest = -1;
+        double  nearGap = 0.;
+        for ( int32_t cNr = 0; cNr < count; ++cNr ) {
+            if ( ( cNr != least ) && ( cand[cNr]->z > 0. ) ) {
+                double gap = std::max( faint->z, cand[cNr]->z )
+                             - std::min( faint->z + faint->range, cand[cNr]->z + cand[cNr]->range );
+                if ( ( nearest < 0 ) || ( gap < nearGap ) ) {
+                    nearest = cNr;
+                    nearGap = gap;
+                }
+            }
+        }
+
+        // 3.: Merge both over the range they cover together
+        if ( nearest > -1 ) {
+            sDustPixel* other   = cand[nearest];
+            double      spStart = std::min( faint->z, other->z );
+            double      spRange = std::max( faint->z + faint->range, other->z + other->range ) - spStart;
+            int32_t     spRed = 0, spGre = 0, spBlu = 0;
+            double      spMaxRange = mergeDustParts( spRange, faint->maxRange, faint->r, faint->g, faint->b,
+                                                     other->maxRange, other->r, other->g, other->b,
+                                                     spRed, spGre, spBlu );
+            // The new dust sphere has no node, so the result is stored in the one freed by the merge
+            sDustPixel* target = ( other == &fresh ) ? faint : other;
+            target->setAll( spStart,
+                            static_cast<uint8_t>( std::min( spRed, 255 ) ),
+                            static_cast<uint8_t>( std::min( spGre, 255 ) ),
+                            static_cast<uint8_t>( std::min( spBlu, 255 ) ),
+                            spRange, spMaxRange );
+            if ( target == faint )
+                return;
+        }
+    }
+
+    // 4.: If the new dust sphere was neither merged nor merged into, it takes the freed node
+    if ( faint != &fresh )
+        faint->setAll( fresh.z, fresh.r, fresh.g, fresh.b, fresh.range, fresh.maxRange );
+}
+
+
 /// @brief move dust sphere information up to free @a toFree of data
 void ENVIRONMENT::moveDustSpheresUp ( sDustPixel* toFree, int32_t x, int32_t y ) {
-    sDustPixel* curr = &zDustMap[x][y];
+    sDustPixel* curr = &zDustMap[y][x];
 
     // Note: This method must not be called if the root item is taken! Check beforehand!
     assert ( ( curr->z < 0. ) && "ERROR: You did not check the root item before calling moveDustSpheresUp()! HOW DARE YOU!" );
@@ -257,22 +424,12 @@ int32_t ENVIRONMENT::splitDust ( sDustPixel* dust, int32_t x, int32_t y, double&
         double spEnd = spStart + spRange;
 
         // Now we have all values to calculate the combined color of the split
-        double opacityA    = maxRange / spRange;
-        double opacityB    = dust->maxRange / spRange;
-        double spOpacity   = opacityA + opacityB;
-        double spMaxRange  = spRange / spOpacity;
-        bool   isLongSplit = false; // If this stays being false, not all shifts are done below
-        bool   doOverwrite = false; // Set to true below if *dust has to be reduced to an unusable size
         int32_t spRed = 0, spGre = 0, spBlu = 0;
-        if ( isDustLargeEnough( spRange, spMaxRange ) ) {
-            isLongSplit = true;
-            spRed = static_cast<uint32_t>(  std::round( static_cast<double>(      r ) * ( opacityA / spOpacity ) )
-                                            + std::round( static_cast<double>( dust->r ) * ( opacityB / spOpacity ) ) );
-            spGre = static_cast<uint32_t>(  std::round( static_cast<double>(      g ) * ( opacityA / spOpacity ) )
-                                            + std::round( static_cast<double>( dust->g ) * ( opacityB / spOpacity ) ) );
-            spBlu = static_cast<uint32_t>(  std::round( static_cast<double>(      b ) * ( opacityA / spOpacity ) )
-                                            + std::round( static_cast<double>( dust->b ) * ( opacityB / spOpacity ) ) );
-        }
+        double spMaxRange  = mergeDustParts( spRange, maxRange, r, g, b,
+                                             dust->maxRange, dust->r, dust->g, dust->b,
+                                             spRed, spGre, spBlu );
+        bool   isLongSplit = isDustLargeEnough( spRange, spMaxRange ); // If this is false, not all shifts are done below
+        bool   doOverwrite = false; // Set to true below if *dust has to be reduced to an unusable size
 
         // Before we add the split, z+range and *dust need to be corrected, or the adding of the split wreaks havoc!
         if ( isCaseA ) {
@@ -383,24 +540,77 @@ int32_t ENVIRONMENT::splitDust ( sDustPixel* dust, int32_t x, int32_t y, double&
 }
 
 
-/// @brief this little helper initializes the zMaps. Width and Height **MUST** be fixed when calling this!
+/// @brief return the number of pixels a row of the zMaps holds, rows are padded to full cache lines
+int32_t ENVIRONMENT::getZRowLen() const {
+    // Eight pixels are a multiple of the cache line size for both sDustPixel and sMassWord
+    return ( scrWidth + 7 ) & ~7;
+}
+
+
+/** @brief this little helper initializes the zMaps. Width and Height **MUST** be fixed when calling this!
+  *
+  * Both maps are one contiguous, cache line aligned block of pixels each, in
+  * row-major order. zDustMap[y] and zMassMap[y] point to the start of row y,
+  * which is padded to getZRowLen() pixels so every row starts on a cache line.
+  * Neither sDustPixel nor sMassWord have a vtable, so a pixel is not larger
+  * than its data.
+  *
+  * The dust arena for the chained dust sphere pixels and the sphere profile
+  * tables projectUnit() uses are set up here, too.
+**/
 int32_t ENVIRONMENT::initZMaps() {
-    int32_t result = EXIT_SUCCESS;
+    int32_t result  = EXIT_SUCCESS;
+    size_t  rowLen  = static_cast<size_t>( getZRowLen() );
+    size_t  xSize   = rowLen * static_cast<size_t>( scrHeight );
+    size_t  perPix  = sizeof( sDustPixel ) + sizeof( sMassWord );
 
     try {
-        zDustMap = new sDustPixel*[scrWidth];
-        zMassMap = new sMassPixel*[scrWidth];
-        for ( int32_t x = 0; x < scrWidth; ++x ) {
-            zDustMap[x] = new sDustPixel[scrHeight];
-            zMassMap[x] = new sMassPixel[scrHeight];
+        zDustMap    = new sDustPixel*[scrHeight];
+        zDustMap[0] = NULL;
+        zMassMap    = new sMassWord*[scrHeight];
+        zMassMap[0] = NULL;
+
+        void* dustBuf = ::operator new( xSize * sizeof( sDustPixel ), std::align_val_t( Cache_Line ) );
+        for ( size_t i = 0; i < xSize; ++i )
+            new ( static_cast<sDustPixel*>( dustBuf ) + i ) sDustPixel();
+        zDustMap[0] = static_cast<sDustPixel*>( dustBuf );
+
+        void* massBuf = ::operator new( xSize * sizeof( sMassWord ), std::align_val_t( Cache_Line ) );
+        for ( size_t i = 0; i < xSize; ++i )
+            new ( static_cast<sMassWord*>( massBuf ) + i ) sMassWord();
+        zMassMap[0] = static_cast<sMassWord*>( massBuf );
+
+        for ( int32_t y = 1; y < scrHeight; ++y ) {
+            zDustMap[y] = zDustMap[0] + ( rowLen * y );
+            zMassMap[y] = zMassMap[0] + ( rowLen * y );
         }
+
+        dustArena = new CDustArena();
+        sphereLut = new CSphereLUT();
     } catch ( std::bad_alloc& e ) {
         result = EXIT_FAILURE;
-        int32_t xSize = scrWidth * scrHeight;
-        cerr << "ERROR: unable to allocate " << ( ( xSize * sizeof ( sDustPixel ) ) + ( xSize * sizeof ( sMassPixel ) ) );
+        cerr << "ERROR: unable to allocate " << ( xSize * perPix );
         cerr << " bytes for the zMaps! [" << e.what() << "]" << endl;
     }
 
+    // The chained dust sphere pixels are limited to a fixed average per pixel, or
+    // to what --dust-layers allows beyond the root, so the arena never runs full then.
+    if ( EXIT_SUCCESS == result ) {
+        int64_t perPixel = dustLayers > 0 ? dustLayers - 1 : Dust_Arena_Per_Pixel;
+        result = dustArena->init( static_cast<int64_t>( scrWidth ) * scrHeight * perPixel );
+    }
+
+    if ( EXIT_SUCCESS == result )
+        result = sphereLut->init();
+
+    if ( EXIT_SUCCESS == result ) {
+        cout << "Pixel maps: " << perPix << " bytes per pixel (" << sizeof( sMassWord ) << " mass + ";
+        cout << sizeof( sDustPixel ) << " dust), " << ( ( xSize * perPix ) >> 10 ) << " KiB for ";
+        cout << scrWidth << "x" << scrHeight << " pixels" << endl;
+        cout << "Dust arena: up to " << ( ( dustArena->capacity() * sizeof( sDustPixel ) ) >> 10 );
+        cout << " KiB for chained dust spheres" << endl;
+    }
+
     return result;
 }
 
@@ -424,7 +634,7 @@ bool ENVIRONMENT::isDustVisible( int32_t x, int32_t y, double& z, double& range
         // Note: Min_Dust_Range is used as an "Epsilon" of larger than zero here.
         return false;
 
-    double  zMassZ = zMassMap[x][y].z;
+    double  zMassZ = zMassMap[y][x].getZ();
 
     /* There are two modifying conditions:
      * a) The dust sphere starts with z < 0, but reaches into view via its range
@@ -540,7 +750,11 @@ int32_t ENVIRONMENT::projectDust ( int32_t x, int32_t y, double z, uint8_t r, ui
     if ( !isValid )
         return result;
 
-    sDustPixel* root       = &zDustMap[x][y];
+    // Without ordering, all the work is left to resolveDust()
+    if ( EDM_SORT == dustMode )
+        return appendDust( x, y, z, r, g, b, range, maxRange );
+
+    sDustPixel* root       = &zDustMap[y][x];
     sDustPixel* curr       = root;
     sDustPixel* next       = curr->next;
     bool        checkCaseA = curr->z > z ? true : false; // This makes things easier below.
@@ -666,20 +880,24 @@ int32_t ENVIRONMENT::projectDust ( int32_t x, int32_t y, double z, uint8_t r, ui
         } else {
             // we have to add a new one, this applies to Cases A and C:
             try {
-                sDustPixel* newDust = new sDustPixel();
-
-                // The new dust sphere is always placed behind curr
-                newDust->next = next;
-                curr->next    = newDust;
-
-                // We must check whether curr is the root item.
-                if ( ( curr == root ) && ( curr->z < z ) ) {
-                    // This applies to Case C
-                    *newDust = *curr;
-                    next     = newDust;
+                sDustPixel* newDust = dustArena->alloc();
+
+                if ( newDust ) {
+                    // The new dust sphere is always placed behind curr
+                    newDust->next = next;
+                    curr->next    = newDust;
+
+                    // We must check whether curr is the root item.
+                    if ( ( curr == root ) && ( curr->z < z ) ) {
+                        // This applies to Case C
+                        *newDust = *curr;
+                        next     = newDust;
+                    } else
+                        // Otherwise this is Case A
+                        curr = newDust;
                 } else
-                    // Otherwise this is Case A
-                    curr = newDust;
+                    // The arena is full, this dust sphere is dropped for this frame
+                    isValid = false;
             } // end of adding a new dust sphere to the queue
             catch ( std::bad_alloc& e ) {
                 cerr << "ERROR : Unable to generate a new dust sphere pixel \n";
@@ -689,7 +907,7 @@ int32_t ENVIRONMENT::projectDust ( int32_t x, int32_t y, double z, uint8_t r, ui
         } // End of handling a full queue
 
         // Now set curr to our values unless the creation of a new item was unsuccessful:
-        if ( EXIT_SUCCESS == result ) {
+        if ( ( EXIT_SUCCESS == result ) && isValid ) {
             curr->setAll ( z, r, g, b, range, maxRange );
             assert( ( curr->next == next ) && "ERROR: curr->next does not equal next. How can this be?" );
             assert ( ( ( NULL == curr->next ) || ( curr->next->z < curr->z ) || ( curr->z < 0. ) )
@@ -702,33 +920,162 @@ int32_t ENVIRONMENT::projectDust ( int32_t x, int32_t y, double z, uint8_t r, ui
 
 /** @brief project a mass pixel onto the zMassMap
   *
-  * IMPORTANT: env must have been locked, and the position checked beforehand!
+  * The mass pixel itself is set lock-free, see sMassWord::setNearer(). If it
+  * is the nearest mass afterwards, all dust spheres behind it are invalidated,
+  * which needs the zDustMap pixel for itself. If other threads may write into
+  * the same pixel, @a doLock must be set to true, and env must _not_ be locked.
+  *
+  * IMPORTANT: the position must have been checked beforehand!
   */
-void ENVIRONMENT::projectMass ( int32_t x, int32_t y, double z, uint8_t r, uint8_t g, uint8_t b ) {
+void ENVIRONMENT::projectMass ( int32_t x, int32_t y, double z, uint8_t r, uint8_t g, uint8_t b, bool doLock ) {
+    assert ( ( x >= 0 ) && ( x < scrWidth ) && ( y >= 0 ) && ( y < scrHeight )
+             && "What on earth am I supposed to do with a pixel not on the plane?" );
+
     // The mass pixel must be visible:
-    if ( z < universe->M2Pos ) {
+    if ( z < universe->M2Pos )
         z = universe->M2Pos;
-        // But this means it might not be front any more
-        if ( !( z < zMassMap[x][y].z ) )
-            return;
+
+    // Unordered chains are cut at the mass by resolveDust()
+    if ( zMassMap[y][x].setNearer( z, r, g, b ) && ( EDM_INSERT == dustMode ) ) {
+        // Now invalidate all dust sphere(parts) that are behind the stored z
+        if ( doLock ) lock();
+        invalidateDustSpheres( x, y, zMassMap[y][x].getZ() );
+        if ( doLock ) unlock();
     }
+}
 
-    // Now check...
-    assert ( ( x >= 0 ) && ( x < scrWidth ) && ( y >= 0 ) && ( y < scrHeight )
-             && "What on earth am I supposed to do with a pixel not on the plane?" );
-    assert ( ( ( zMassMap[x][y].z < 0. ) || ( z < zMassMap[x][y].z ) )
-             && "(MASS) You did NOT check whether z is smaller than zMassMap[x][y].z! SHAME ON YOU!" );
-
-    // ...and set
-    if ( ( zMassMap[x][y].z < 0. ) || ( z < zMassMap[x][y].z ) ) {
-        zMassMap[x][y].z = z;
-        zMassMap[x][y].r = r;
-        zMassMap[x][y].g = g;
-        zMassMap[x][y].b = b;
-
-        // Now invalidate all dust sphere(parts) that are behind this z
-        invalidateDustSpheres( x, y, z );
+
+/** @brief blend the dust sphere parts @a frags of one pixel over the mass color
+  *
+  * All parts are cut at the mass and sorted by their far ends. One sweep from
+  * the far end to the near end visits every part of the depth range where the
+  * same fragments overlap. These are merged with the arithmetic splitDust()
+  * uses, and blended over the color. The order of @a frags does therefore not
+  * change the result. @a frags is used as scratch space and emptied.
+  *
+  * @param[in] massZ Position of the mass in this pixel, or a negative value if there is none
+  * @param[in,out] r Red part of the mass color, the result on return
+  * @param[in,out] g Green part of the mass color, the result on return
+  * @param[in,out] b Blue part of the mass color, the result on return
+  * @param[in,out] frags All dust sphere parts of the pixel
+**/
+void ENVIRONMENT::blendDustFrags( double massZ, uint8_t& r, uint8_t& g, uint8_t& b, std::vector<sDustFrag>& frags ) {
+    // 1.: Cut all fragments at the mass
+    size_t count = 0;
+    for ( size_t fNr = 0; fNr < frags.size(); ++fNr ) {
+        sDustFrag& frag = frags[fNr];
+        if ( ( massZ > 0. ) && ( frag.end > massZ ) )
+            frag.end = massZ;
+        if ( isDustLargeEnough( frag.end - frag.z, frag.maxRange ) )
+            frags[count++] = frag;
     }
+    frags.resize( count );
+
+    // 2.: Sort them, so the result does not depend on the order they were projected in
+    std::sort( frags.begin(), frags.end(), sortDustFrag );
+
+    /* 3.: Sweep from the far end to the near end. frags[0, active) are the
+     *     fragments reaching over the current far end hi, frags[open, count)
+     *     those that start to be visible further ahead. The space in between
+     *     is free to take the fragments that become active.
+    */
+    size_t active = 0;
+    size_t open   = 0;
+    double hi     = count ? frags[0].end : 0.;
+
+    while ( open < count || active ) {
+        // a) Activate all fragments reaching over hi
+        while ( ( open < count ) && !( frags[open].end < hi ) )
+            frags[active++] = frags[open++];
+
+        // b) Drop all fragments that end at hi, the nearest remaining start is the near end of this part
+        double lo   = open < count ? frags[open].end : -1.;
+        size_t kept = 0;
+        for ( size_t fNr = 0; fNr < active; ++fNr ) {
+            if ( frags[fNr].z < hi ) {
+                if ( frags[fNr].z > lo )
+                    lo = frags[fNr].z;
+                frags[kept++] = frags[fNr];
+            }
+        }
+        active = kept;
+
+        if ( 0 == active ) {
+            // There is a gap up to the next fragment
+            if ( open < count )
+                hi = frags[open].end;
+            continue;
+        }
+
+        // c) Merge all active fragments over this part and blend it in
+        double  spRange    = hi - lo;
+        double  spMaxRange = frags[0].maxRange;
+        int32_t spRed = frags[0].r, spGre = frags[0].g, spBlu = frags[0].b;
+        for ( size_t fNr = 1; fNr < active; ++fNr ) {
+            spMaxRange = mergeDustParts( spRange, spMaxRange,
+                                         static_cast<uint8_t>( std::min( spRed, 255 ) ),
+                                         static_cast<uint8_t>( std::min( spGre, 255 ) ),
+                                         static_cast<uint8_t>( std::min( spBlu, 255 ) ),
+                                         frags[fNr].maxRange, frags[fNr].r, frags[fNr].g, frags[fNr].b,
+                                         spRed, spGre, spBlu );
+        }
+
+        if ( isDustLargeEnough( spRange, spMaxRange ) )
+            blendDust( r, g, b,
+                       static_cast<uint8_t>( std::min( spRed, 255 ) ),
+                       static_cast<uint8_t>( std::min( spGre, 255 ) ),
+                       static_cast<uint8_t>( std::min( spBlu, 255 ) ),
+                       spRange / spMaxRange );
+
+        hi = lo;
+    } // End of sweep
+
+    frags.clear();
+}
+
+
+/** @brief put the dust spheres of one pixel together over the mass color
+  *
+  * This is the drawing side of EDM_SORT. All dust spheres in the chain of the
+  * pixel are copied into @a frags and blended by blendDustFrags().
+  *
+  * The chain is emptied, but the root keeps its next, which thrdDraw() clears.
+  *
+  * @param[in] x X-Coordinate of the pixel
+  * @param[in] y Y-Coordinate of the pixel
+  * @param[in] massZ Position of the mass in this pixel, or a negative value if there is none
+  * @param[in,out] r Red part of the mass color, the result on return
+  * @param[in,out] g Green part of the mass color, the result on return
+  * @param[in,out] b Blue part of the mass color, the result on return
+  * @param[in] frags Scratch space of the calling thread
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the fragments could not be stored
+**/
+int32_t ENVIRONMENT::resolveDust( int32_t x, int32_t y, double massZ, uint8_t& r, uint8_t& g, uint8_t& b,
+                                  std::vector<sDustFrag>& frags ) {
+    sDustPixel* root = &zDustMap[y][x];
+
+    if ( root->z < -1.5 )
+        return EXIT_SUCCESS;
+
+    // Collect all dust spheres, the cutting and sorting is done by blendDustFrags()
+    frags.clear();
+    try {
+        for ( sDustPixel* dust = root; dust; dust = dust->next ) {
+            if ( dust->z > 0. ) {
+                sDustFrag frag = { dust->z, dust->z + dust->range, dust->maxRange, dust->r, dust->g, dust->b };
+                frags.push_back( frag );
+            }
+        }
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate dust fragments! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+    root->invalidate();
+    root->z = -2.0;
+
+    blendDustFrags( massZ, r, g, b, frags );
+
+    return EXIT_SUCCESS;
 }
 
 
@@ -785,9 +1132,16 @@ void ENVIRONMENT::setDynamicZ() {
 }
 
 
-/// @brief simple function to start all threads with a given function
-void ENVIRONMENT::startThreads ( void ( *aCb ) ( void* ) ) {
-    for ( int32_t tNum = 0; tNum < numThreads; ++tNum ) {
+/** @brief simple function to start all threads of a group with a given function
+  *
+  * The threads of group 1 are numbered behind those of group 0, so they have
+  * their own progress in threadPrg and threadRun.
+  *
+  * @param[in] aCb The thread function
+  * @param[in] group The group of threads, 1 is the renderer with --pipeline
+**/
+void ENVIRONMENT::startThreads ( void ( *aCb ) ( void* ), int32_t group ) {
+    for ( int32_t tNum = group * numThreads; tNum < ( group + 1 ) * numThreads; ++tNum ) {
         lock();
         threadEnv* env = new threadEnv ( this, tNum );
         thread[tNum] = new sf::Thread ( aCb, env );
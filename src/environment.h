@@ -2,6 +2,7 @@
 #define PWX_GRAVMAT_ENVIRONMENT_H
 
 #include <string>
+#include <vector>
 using std::string;
 
 #include <pwx_compiler.h>
@@ -15,28 +16,93 @@ using std::string;
 // CColorMap is forward to keep SFML out
 class CColorMap;
 
+// The collision broad-phases and the merge graph are only needed by sfmlui.cpp:
+class CCollBVH;
+class CCollGraph;
+class CCollGrid;
+class CCollLog;
+class CCollSAP;
+
+// So are the tile bins of the tile renderer, the ray casting hierarchy, the coarse depth of the masses and the LOD merging:
+class CHiZMap;
+class CLodMap;
+class CRayBVH;
+class CTileBins;
+
+// The dust arena and the sphere profiles are created by initZMaps():
+class CDustArena;
+class CSphereLUT;
+
+// The picture writers are created by initSFML():
+class CFrameWriter;
+
 // Same with CMatter:
 class CMatter;
 
 // The Pixel Info classes have their implementation in the header and therefore should be forwarded anyway:
+struct sDustFrag;
 struct sDustPixel;
-struct sMassPixel;
+struct sMassWord;
+
+/// @brief The broad-phase thrdCheck() uses to find collision candidates, set with --collision
+enum eCollMode {
+    ECM_GRID = 0, //!< Uniform 3D spatial hash, only units in adjacent cells are checked (default)
+    ECM_RADIAL,   //!< Scan neighbours in the distance-to-center order
+    ECM_SAP,      //!< Incremental sweep-and-prune, only units overlapping on all three axes are checked
+    ECM_BVH       //!< Refitted bounding volume hierarchy, only units with overlapping boxes are checked
+};
+
+/// @brief How the dust spheres are put together, set with --dust-mode
+enum eDustMode {
+    EDM_INSERT = 0, //!< Every dust sphere is inserted in depth order, splitting those it overlaps (default)
+    EDM_SORT        //!< Dust spheres are only collected, thrdDraw() sorts them and resolves all overlaps at once
+};
+
+/// @brief The largest number of dust sphere pixels per pixel --dust-layers accepts
+const int32_t Max_Dust_Layers = 16;
+
+/// @brief How the units are projected onto the zMassMap and zDustMap, set with --renderer
+enum eRenderMode {
+    ERM_TILES = 0, //!< Units are binned into screen tiles, every tile is projected by one thread without locking (default)
+    ERM_UNITS,     //!< Every thread projects whole units, each pixel is written under the global lock
+    ERM_RAYCAST    //!< Nothing is projected, every thread traces whole rows of pixels through a hierarchy of the units
+};
+
+/// @brief How the pictures are written into the stream, set with --stream-format
+enum eStreamFormat {
+    ESF_Y4M = 0, //!< YUV4MPEG2 with 4:2:0 chroma, the header tells the encoder the size and frame rate (default)
+    ESF_RGB24    //!< Raw RGB with 3 bytes per pixel and no header at all
+};
 
 /** @struct ENVIRONMENT
   * @brief struct to keep general values together that are used in the programs functions
 **/
 struct ENVIRONMENT: public pwx::CLockable {
     double            camDist;     //!< The distance of the camera (eye) to the projection plane (window) according to fov
+    CCollBVH*         collBvh;     //!< Bounding volume hierarchy for the ECM_BVH collision broad-phase
+    bool              collGate;    //!< Set by prepColl() if the gaps of the last collision check can be trusted
+    CCollGraph*       collGraph;   //!< Groups of colliding units found by the collision check
+    CCollGrid*        collGrid;    //!< Spatial hash for the ECM_GRID collision broad-phase
+    CCollLog*         collLog;     //!< Binary log of all merges, only created with --mergelog
+    eCollMode         collMode;    //!< Which broad-phase to use for the collision check
+    CCollSAP*         collSap;     //!< Sorted axis lists for the ECM_SAP collision broad-phase
+    double            collSkin;    //!< Range beyond the collision range the broad-phases cover, the gaps are measured over it
     CColorMap*        colorMap;    //!< Map to generate colors from
     int32_t           currFrame;   //!< Which frame of a cycle is currently the next to draw
     double            cyclPerFrm;  //!< How man cycles (fraction) are done per frame, used for explosion ring size increase
     bool              doDynamic;   //!< If set to true (--dyncam), the camera is moved towards the nearest unit.
     bool              doHalfX;     //!< Set to true by --halfX and skips every second X pixel
     bool              doHalfY;     //!< Set to true by --halfY and skips every second Y pixel
+    bool              doHeadless;  //!< Set to true by --headless, no window is opened and the progress goes to stderr
     bool              doPause;     //!< Toggled with the pause key while running
+    bool              doPipeline;  //!< Set to true by --pipeline, a second thread group renders while the units move on
+    bool              doSweep;     //!< Set to true by --ccd, collisions are searched along the last movement step
     bool              doVideo;     //!< Set to true if the output is a video
     bool              doWork;      //!< is set to false if no work is to be done
     bool              drawDust;    //!< set to false for the first, and to true for the second drawing run
+    CDustArena*       dustArena;   //!< Storage for the dust sphere pixels chained behind the zDustMap, see initZMaps()
+    int32_t           dustLayers;  //!< Maximum number of dust sphere pixels per pixel with --dust-layers, zero if unbounded
+    eDustMode         dustMode;    //!< How the dust spheres are put together
     double            dynMaxZ;     //!< the used maxZ for projection, equals maxZ unless --dyncam is set
     int32_t           elaDay;      //!< How many days have been processed
     int32_t           elaHour;     //!< How many hours have been processed
@@ -49,22 +115,31 @@ struct ENVIRONMENT: public pwx::CLockable {
     float             fontSize;    //!< Base size of the font, used to determine the text box sizes
     double            fov;         //!< Field of vision, defaults to 90.0 degrees
     int32_t           fps;         //!< Set FPS, argument --fps to override (default 50)
+    ::std::vector<uint8_t> frameBuf; //!< RGBA pixels the tracing threads draw into row by row, the image gets them in one go
+    CFrameWriter*     frameWriter; //!< Pool of threads saving the pictures, only created if --writers is not zero
     double            halfHeight;  //!< Half the screen height for perspective calculation as double
     double            halfWidth;   //!< Half the screen width for perspective calculation as double
     bool              hasUserTime; //!< Set to true if the timescale or one of their aliases is used, so the default isn't applied
-    sf::Image         image;       //!< The image to be rendered
+    CHiZMap*          hiZMap;      //!< Coarse depth of the masses, used to skip hidden units before they are colored
+    sf::Image         image;       //!< The image shown on the screen, it gets frameBuf once a picture is done
     bool              initFinished;//!< Set to true once the first gravitational calculation is done
     bool              isLoaded;    //!< Set to true if we successfully loaded data from a file
+    CLodMap*          lodMap;      //!< Merges units too small to be seen on their own, only created with --lod
+    double            lodRad;      //!< Units with a smaller view radius are merged per pixel with --lod, zero if off
     double            minZ;        //!< set while moving it is used to move the projection plane if --dyncam is used
     double            maxZ;        //!< used for perspective calculation
+    ::std::string     mergeLog;    //!< Name of the (optional) file all merges are logged into
     char              msg[256];    //!< message to display at the bottom of the screen
     int32_t           numThreads;  //!< Number of threads to spawn for the workloop calculations. Default is 8
+    int32_t           numWriters;  //!< Number of threads saving the pictures, zero saves them in the workloop. Default is 2
     double            offX;        //!< x-offset
     double            offY;        //!< y-offset
     double            offZ;        //!< z-offset
     ::std::string     outFileFmt;  //!< The format string for the output files.
     int32_t           picNum;      //!< Number of the picture currently displayed on screen
     char              prgFmt[25];  //!< Dynamic progress format string set up according to the maximum number of units
+    CRayBVH*          rayBvh;      //!< Hierarchy of the unit footprints the rays are traced through, only created for ERM_RAYCAST
+    eRenderMode       renderMode;  //!< How the units are projected onto the projection plane
     ::std::string     saveFile;    //!< Name of the (optional) save file to load from and save into.
     sf::RenderWindow* screen;      //!< the screen to be created
     int32_t           scrHeight;   //!< height of the screen
@@ -74,26 +149,40 @@ struct ENVIRONMENT: public pwx::CLockable {
     int64_t*          secPerFrame; //!< Dynamic array for the number of frames to catch rounding errors
     double            secPFmod;    //!< Used to modify impulse and movement for low secPerCycle scenarios
     int32_t           seed;        //!< If set by command line argument, sets a new seed for RNG
+    ::std::string     shmName;     //!< Name of the (optional) shared memory all pictures are published in
+    int32_t           shmSlots;    //!< Number of pictures the shared memory ring holds (default 4)
     bool              shockwave;   //!< Use shock wave algorithm to initialize matter units
     char              sortFmt[64]; //!< Special format string for the (obscure) sorting status message
+    CSphereLUT*       sphereLut;   //!< Distance tables for projecting the units, see initZMaps()
     double            spxRedu;     //!< Simplex Reduction Value, defaults to 1.0
     double            spxSmoo;     //!< Simplex Smooth Value, defaults to 1.0
     int32_t           spxWave;     //!< Simplex Waves Value, defaults to 1
     double            spxZoom;     //!< Simplex Zoom, defaults to 4.0
     sf::Clock         statClock;   //!< used to determine the time elapsed for the message line (bottom)
+    int64_t           statCollCand;//!< Number of candidate pairs the last collision check has tested
+    int64_t           statCollMerge;//!< Number of units the last collision check has merged into others
+    int64_t           statCollSkip;//!< Number of units the last collision check has skipped for their gap
+    int64_t           statCollSwept;//!< Number of colliding pairs only the sweep of --ccd has found, they do not touch any more
     double            statCurrMove;//!< Currently sum of maximum movements. Used to know when a new grav calc is needed
     int32_t           statDone;    //!< Record Progress
+    int64_t           statDustDrop;//!< Number of chained dust sphere pixels the last frame has dropped, the arena was full
+    int64_t           statHidden;  //!< Number of units the last projection has skipped as hidden behind nearer masses
+    int64_t           statLodMerged;//!< Number of units the last projection has merged into impostors with --lod
     double            statMaxAccel;//!< Maximum observed acceleration in m/s²
     double            statMaxMove; //!< Maximum observed movement in m/s
     uint32_t          statMaxWidth;//!< Width of the status lines, will be maxed out for a "quieter" display
     float             statTimeEla; //!< Used to only update the stat lines once (top) per second
     char              statMsg[256];//!< Text for the stats in the top left corner
-    sf::Thread**      thread;      //!< The threads themselves.
+    ::std::string     statusFile;  //!< Name of the (optional) file the progress is written into with --headless
+    eStreamFormat     streamFmt;   //!< How the pictures are written into the stream
+    ::std::string     streamPath;  //!< Name of the (optional) pipe or file all pictures are streamed into, "-" for stdout
+    sf::Thread**      thread;      //!< The threads themselves, numThreads per group, see getThrdGroups()
     volatile int32_t* threadPrg;   //!< Threads write their progress in this
     volatile bool*    threadRun;   //!< Threads set it to true when they start and to false when they end
+    CTileBins*        tileBins;    //!< Screen tiles with the units touching them, only created for ERM_TILES
     UNIVERSE*         universe;    //!< Collection of constants describing this very universe for further physics calculations
-    sDustPixel**      zDustMap;    //!< Map over pixels which represent a dust sphere point
-    sMassPixel**      zMassMap;    //!< Map over pixels which represent a mass point
+    sDustPixel**      zDustMap;    //!< Rows ([y][x]) of pixels which represent a dust sphere point, see initZMaps()
+    sMassWord**       zMassMap;    //!< Rows ([y][x]) of pixels which represent a mass point, written lock-free
 
     /* --- non-struct methods --- */
     const char* getVersion() const;
@@ -108,10 +197,16 @@ struct ENVIRONMENT: public pwx::CLockable {
     // The dtor is outline
     ~ENVIRONMENT();
 
-    // Helper to clear all threads:
-    void clearThreads();
+    // Blend the dust sphere parts of one pixel over the mass color, used by resolveDust() and the ray caster:
+    void blendDustFrags( double massZ, uint8_t& r, uint8_t& g, uint8_t& b, std::vector<sDustFrag>& frags );
+    // Helper to clear all threads of a group:
+    void clearThreads( int32_t group = 0 );
     // Helper to initialize the zMaps
     int32_t initZMaps();
+    /// @brief return the number of thread groups, the renderer has its own with --pipeline
+    int32_t getThrdGroups() const { return doPipeline ? 2 : 1; }
+    // Return the number of pixels a row of the zMaps holds, including the padding
+    int32_t getZRowLen() const PWX_WARNUNUSED;
     // Helper to load working state from saveFile:
     int32_t load();
     // Return true if the current movement requires a new calculation of the gravitation
@@ -122,17 +217,25 @@ struct ENVIRONMENT: public pwx::CLockable {
                          double range, double maxRange )   PWX_WARNUNUSED;
     // Project a mass pixel unto the zMassMap
     void    projectMass( int32_t x, int32_t y, double z,
-                         uint8_t r, uint8_t g, uint8_t b );
+                         uint8_t r, uint8_t g, uint8_t b, bool doLock = false );
+    // Put the dust spheres of one pixel together over the mass color, used with EDM_SORT:
+    int32_t resolveDust( int32_t x, int32_t y, double massZ,
+                         uint8_t& r, uint8_t& g, uint8_t& b,
+                         std::vector<sDustFrag>& frags ) PWX_WARNUNUSED;
     // Helper to save the current state into saveFile:
     int32_t save( std::ofstream& outFile );
     // Helper to set dynMaxZ
     void    setDynamicZ();
-    // Helper Method to start all threads:
-    void    startThreads( void ( *aCb )( void* ) );
+    // Helper Method to start all threads of a group:
+    void    startThreads( void ( *aCb )( void* ), int32_t group = 0 );
 
   private:
     // find a dust sphere pixel with a lower z that is either the last one or has a next with a larger z than given
     inline sDustPixel* findPrevDust( sDustPixel* start, double z ) PWX_WARNUNUSED;
+    // Add a dust sphere to the chain without ordering, used with EDM_SORT:
+    inline int32_t appendDust( int32_t x, int32_t y, double z,
+                               uint8_t r, uint8_t g, uint8_t b,
+                               double range, double maxRange ) PWX_WARNUNUSED;
     // Invalidate all dust spheres up to a specific z:
     inline void invalidateDustSpheres( int32_t x, int32_t y, double z );
     // return true if range and maxRange are large enough
@@ -141,6 +244,10 @@ struct ENVIRONMENT: public pwx::CLockable {
     inline bool isDustUseful( int32_t x, int32_t y, double& z, double& range, double maxRange ) PWX_WARNUNUSED;
     // return true if the dust sphere is not blocked by a mass, correct range if it reaches into a mass
     inline bool isDustVisible( int32_t x, int32_t y, double& z, double& range ) PWX_WARNUNUSED;
+    // Merge the faintest dust sphere of a full pixel into its nearest neighbour:
+    inline void mergeDustLayer( int32_t x, int32_t y, double z,
+                                uint8_t r, uint8_t g, uint8_t b,
+                                double range, double maxRange );
     // Move all dust spheres up unto a specific one to make space in between for a new one
     inline void moveDustSpheresUp( sDustPixel* toFree, int32_t x, int32_t y );
     // split a dust sphere into two, adding up colors and opacities
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <csignal>
+
+#include "framewriter.h"
+#include "shmring.h"
+
+
+/// @brief return the 8 bit luma of @a r, @a g and @a b, BT.601 in studio range
+static inline uint8_t getLuma( int32_t r, int32_t g, int32_t b ) {
+    return static_cast<uint8_t>( ( ( 66 * r + 129 * g + 25 * b + 128 ) >> 8 ) + 16 );
+}
+
+
+/// @brief save all pictures left, stop the writers and free the copies
+CFrameWriter::~CFrameWriter() {
+    stop();
+
+    if ( shmRing ) {
+        delete shmRing;
+        shmRing = NULL;
+    }
+
+    for ( size_t i = 0; i < queue.size(); ++i )
+        delete queue[i];
+    for ( size_t i = 0; i < spare.size(); ++i )
+        delete spare[i];
+    queue.clear();
+    spare.clear();
+}
+
+
+/** @brief publish all pictures in shared memory instead of files
+  *
+  * This must be called before start(). The pictures are published as they
+  * are pushed, the file names are ignored.
+  *
+  * @param[in] name Name of the shared memory
+  * @param[in] slots Number of pictures the ring holds
+  * @param[in] width Width of every picture in pixels
+  * @param[in] height Height of every picture in pixels
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the memory could not be created
+**/
+int32_t CFrameWriter::openShm( const char* name, int32_t slots, uint32_t width, uint32_t height ) {
+    try {
+        shmRing = new CShmRing();
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to create the shared memory ring! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    return shmRing->open( name, slots, width, height );
+}
+
+
+/** @brief write all pictures into a stream instead of files
+  *
+  * This must be called before start(). The pictures are written as they are
+  * pushed, the file names are ignored. Opening a FIFO waits until a reader
+  * has opened it, too. A reader going away does not end the program, the
+  * writer stops and hasStreamError() tells the caller.
+  *
+  * @param[in] path Path of the pipe, FIFO or file, "-" for stdout
+  * @param[in] format How the pictures are written
+  * @param[in] fps Frame rate written into the YUV4MPEG2 header
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the stream could not be opened
+**/
+int32_t CFrameWriter::openStream( const char* path, eStreamFormat format, int32_t fps ) {
+    if ( STREQ( path, "-" ) )
+        stream = stdout;
+    else
+        stream = fopen( path, "wb" );
+
+    if ( !stream ) {
+        cerr << "ERROR: unable to open \"" << path << "\" for the stream!" << endl;
+        return EXIT_FAILURE;
+    }
+
+#if defined(SIGPIPE)
+    // A reader that quits must not kill us, the failed write is noticed instead
+    std::signal( SIGPIPE, SIG_IGN );
+#endif
+
+    streamFmt = format;
+    streamFps = fps;
+    streamHdr = false;
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief copy a picture into the queue
+  *
+  * Only one thread may push pictures. If the queue is full, nothing is done,
+  * the caller has to try again once a writer has taken a picture. If the copy
+  * can not be allocated, the picture is saved right away instead.
+  *
+  * @param[in] pixels RGBA pixels of the finished picture, row by row
+  * @param[in] width Width of the picture in pixels
+  * @param[in] height Height of the picture in pixels
+  * @param[in] name Path of the file the picture is to be saved in
+  * @param[in] number Number of the picture
+  * @param[in] second Simulated second the picture shows
+  * @return true if the picture was taken, false if the queue is full
+**/
+bool CFrameWriter::push( const uint8_t* pixels, uint32_t width, uint32_t height,
+                         const char* name, int32_t number, int64_t second ) {
+    sFrame* frame = NULL;
+
+    // 1.: Refuse the picture if the queue is full, otherwise take a spare copy
+    lock();
+    if ( static_cast<int32_t>( queue.size() ) >= maxQueue ) {
+        if ( !isStalled )
+            ++stalled;
+        isStalled = true;
+        unlock();
+        return false;
+    }
+    isStalled = false;
+    if ( spare.size() ) {
+        frame = spare.back();
+        spare.pop_back();
+    }
+    unlock();
+
+    // 2.: Copy the pixels, no writer knows about the frame yet
+    try {
+        if ( !frame )
+            frame = new sFrame;
+        frame->name   = name;
+        frame->number = number;
+        frame->second = second;
+        frame->width  = width;
+        frame->height = height;
+        frame->pixels.resize( static_cast<size_t>( width ) * height * 4 );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate a copy of picture \"" << name << "\"! [" << e.what() << "]" << endl;
+        if ( frame ) delete frame;
+        sf::Image image;
+        if ( !image.LoadFromPixels( width, height, pixels ) || !image.SaveToFile( name ) ) {
+            lock();
+            ++failed;
+            unlock();
+        }
+        return true;
+    }
+    if ( pixels )
+        std::copy( pixels, pixels + frame->pixels.size(), frame->pixels.begin() );
+
+    // 3.: Hand it over to the writers
+    lock();
+    queue.push_back( frame );
+    unlock();
+
+    return true;
+}
+
+
+/** @brief start the writers
+  *
+  * @param[in] numWriters Number of writer threads, the queue holds framesPerWriter pictures for each
+  * @return EXIT_SUCCESS or EXIT_FAILURE if no writer could be started
+**/
+int32_t CFrameWriter::start( int32_t numWriters ) {
+    maxQueue = framesPerWriter * numWriters;
+    writing  = true;
+
+    try {
+        for ( int32_t wNum = 0; wNum < numWriters; ++wNum ) {
+            sf::Thread* writer = new sf::Thread( &writeLoop, this );
+            writers.push_back( writer );
+            writer->Launch();
+        }
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to start " << numWriters << " picture writers! [" << e.what() << "]" << endl;
+        if ( writers.empty() ) {
+            writing = false;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief stop the writers once the queue is empty and report what they did
+  *
+  * Every picture pushed before is saved, this waits until the last one is.
+**/
+void CFrameWriter::stop() {
+    if ( writers.empty() )
+        return;
+
+    writing = false;
+    for ( size_t wNum = 0; wNum < writers.size(); ++wNum ) {
+        writers[wNum]->Wait();
+        delete writers[wNum];
+    }
+
+    const char* done = stream ? "Streamed " : shmRing ? "Published " : "Saved ";
+    if ( stream ) {
+        if ( stream == stdout )
+            fflush( stream );
+        else
+            fclose( stream );
+        stream = NULL;
+    }
+
+    if ( encoded ) {
+        cout << done << encoded << " pictures with " << writers.size() << " writers, ";
+        cout << ( 1000. * encSum / static_cast<double>( encoded ) ) << " ms on average, ";
+        cout << ( 1000.f * encMax ) << " ms at most, " << stalled << " times the queue was full." << endl;
+    }
+    if ( failed )
+        cerr << "WARNING: " << failed << " pictures could not be saved!" << endl;
+
+    writers.clear();
+}
+
+
+/// @brief the writer thread function, saves pictures until the pool is stopped and the queue is empty
+void CFrameWriter::writeLoop( void* aWriter ) {
+    CFrameWriter* writer = static_cast<CFrameWriter*>( aWriter );
+    sf::Image     image;
+    sf::Clock     clock;
+
+    while ( writer->writing ) {
+        if ( !writer->writeNext( image, clock ) )
+            pwx_sleep( 5 );
+    }
+
+    // Whatever was pushed before the pool was stopped is saved, too
+    while ( writer->writeNext( image, clock ) ) { }
+}
+
+
+/// @brief encode the next picture of the queue, returns false if there was none
+bool CFrameWriter::writeNext( sf::Image& image, sf::Clock& clock ) {
+    sFrame* frame = NULL;
+
+    lock();
+    if ( queue.size() ) {
+        frame = queue.front();
+        queue.pop_front();
+        ++busy;
+    }
+    unlock();
+
+    if ( !frame )
+        return false;
+
+    clock.Reset();
+    bool  saved   = true;
+    if ( shmRing )
+        saved = shmRing->publish( *frame );
+    if ( stream )
+        saved = writeStream( *frame ) && saved;
+    else if ( !shmRing ) {
+        saved = image.LoadFromPixels( frame->width, frame->height, frame->pixels.data() )
+                && image.SaveToFile( frame->name );
+        if ( !saved )
+            cerr << "ERROR: unable to save picture \"" << frame->name << "\"!" << endl;
+    }
+    float elapsed = clock.GetElapsedTime();
+
+    lock();
+    --busy;
+    if ( saved ) {
+        ++encoded;
+        encSum += elapsed;
+        encLast = elapsed;
+        encMax  = std::max( encMax, elapsed );
+    } else
+        ++failed;
+    try {
+        spare.push_back( frame );
+    } catch ( std::bad_alloc& ) {
+        delete frame;
+    }
+    unlock();
+
+    return true;
+}
+
+
+
+/** @brief convert a picture and write it into the stream
+  *
+  * ESF_RGB24 only drops the alpha channel. ESF_Y4M writes the header before
+  * the first frame, then every frame is "FRAME", the full luma plane and both
+  * chroma planes, each averaged over 2x2 pixels.
+  *
+  * Once a write fails, nothing is written any more.
+  *
+  * @param[in] frame The picture to write
+  * @return true if the picture was written
+**/
+bool CFrameWriter::writeStream( const sFrame& frame ) {
+    if ( streamErr )
+        return false;
+
+    uint32_t       width  = frame.width;
+    uint32_t       height = frame.height;
+    const uint8_t* pixels = frame.pixels.data();
+
+    try {
+        if ( ESF_RGB24 == streamFmt ) {
+            streamBuf.resize( static_cast<size_t>( width ) * height * 3 );
+            uint8_t* out = streamBuf.data();
+            for ( size_t i = 0, pixCount = static_cast<size_t>( width ) * height; i < pixCount; ++i ) {
+                *out++ = pixels[4 * i];
+                *out++ = pixels[4 * i + 1];
+                *out++ = pixels[4 * i + 2];
+            }
+        } else {
+            uint32_t cWidth  = ( width  + 1 ) / 2;
+            uint32_t cHeight = ( height + 1 ) / 2;
+            size_t   lSize   = static_cast<size_t>( width ) * height;
+            size_t   cSize   = static_cast<size_t>( cWidth ) * cHeight;
+            streamBuf.resize( lSize + ( 2 * cSize ) );
+            uint8_t* lPlane = streamBuf.data();
+            uint8_t* uPlane = lPlane + lSize;
+            uint8_t* vPlane = uPlane + cSize;
+
+            // 1.: Luma of every pixel
+            for ( size_t i = 0; i < lSize; ++i )
+                lPlane[i] = getLuma( pixels[4 * i], pixels[4 * i + 1], pixels[4 * i + 2] );
+
+            // 2.: Chroma of every 2x2 block, the last row and column are repeated if the size is odd
+            for ( uint32_t cY = 0; cY < cHeight; ++cY ) {
+                uint32_t y0 = 2 * cY;
+                uint32_t y1 = std::min( y0 + 1, height - 1 );
+                for ( uint32_t cX = 0; cX < cWidth; ++cX ) {
+                    uint32_t x0 = 2 * cX;
+                    uint32_t x1 = std::min( x0 + 1, width - 1 );
+                    const uint8_t* p00 = pixels + 4 * ( ( static_cast<size_t>( y0 ) * width ) + x0 );
+                    const uint8_t* p01 = pixels + 4 * ( ( static_cast<size_t>( y0 ) * width ) + x1 );
+                    const uint8_t* p10 = pixels + 4 * ( ( static_cast<size_t>( y1 ) * width ) + x0 );
+                    const uint8_t* p11 = pixels + 4 * ( ( static_cast<size_t>( y1 ) * width ) + x1 );
+                    int32_t r = ( p00[0] + p01[0] + p10[0] + p11[0] + 2 ) >> 2;
+                    int32_t g = ( p00[1] + p01[1] + p10[1] + p11[1] + 2 ) >> 2;
+                    int32_t b = ( p00[2] + p01[2] + p10[2] + p11[2] + 2 ) >> 2;
+                    size_t  idx = ( static_cast<size_t>( cY ) * cWidth ) + cX;
+                    uPlane[idx] = static_cast<uint8_t>( ( ( -38 * r -  74 * g + 112 * b + 128 ) >> 8 ) + 128 );
+                    vPlane[idx] = static_cast<uint8_t>( ( ( 112 * r -  94 * g -  18 * b + 128 ) >> 8 ) + 128 );
+                }
+            }
+        }
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << width << "x" << height << " pixels for the stream! [";
+        cerr << e.what() << "]" << endl;
+        return false;
+    }
+
+    // The header is written with the first frame, only then the size is known
+    if ( ( ESF_Y4M == streamFmt ) && !streamHdr ) {
+        fprintf( stream, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n", width, height, streamFps );
+        streamHdr = true;
+    }
+    if ( ESF_Y4M == streamFmt )
+        fputs( "FRAME\n", stream );
+
+    if ( ( fwrite( streamBuf.data(), 1, streamBuf.size(), stream ) != streamBuf.size() )
+            || fflush( stream ) ) {
+        cerr << "ERROR: writing the stream failed after " << encoded << " frames!" << endl;
+        streamErr = true;
+        return false;
+    }
+
+    return true;
+}
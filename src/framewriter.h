@@ -0,0 +1,134 @@
+#pragma once
+#ifndef PWX_GRAVMAT_FRAMEWRITER_H_INCLUDED
+#define PWX_GRAVMAT_FRAMEWRITER_H_INCLUDED 1
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "environment.h"
+
+// Pictures can be published into shared memory:
+class CShmRing;
+
+
+/// @brief A finished picture waiting to be encoded, with the file it goes into
+struct sFrame {
+    std::string          name;   //!< Path of the picture file
+    int32_t              number; //!< Number of the picture, as used in the file name
+    int64_t              second; //!< Simulated second the picture shows
+    uint32_t             width;  //!< Width of the picture in pixels
+    uint32_t             height; //!< Height of the picture in pixels
+    std::vector<uint8_t> pixels; //!< RGBA pixels of the picture, row by row
+};
+
+
+/** @class CFrameWriter
+  * @brief Pool of writer threads that encode the pictures, set with --writers
+  *
+  * Encoding a picture takes a lot longer than copying its pixels, so push()
+  * only copies the finished picture into a queue and returns. The writers
+  * take the pictures out of the queue and save them while the simulation
+  * goes on with the next second. The queue holds framesPerWriter pictures
+  * per writer at most. push() refuses a picture while it is full, so the
+  * caller has to wait until a writer is done with one.
+  *
+  * The copies are kept and reused once a picture is saved, so no memory is
+  * allocated once the queue was full once.
+  *
+  * With openStream() the pictures are not saved as files, but written one
+  * after the other into a pipe, a FIFO or stdout, see writeStream(). There is
+  * only one writer then, so the frames can not overtake each other. The
+  * same applies to openShm(), which publishes every picture in a ring in
+  * shared memory, see CShmRing. Both can be used at the same time.
+**/
+class CFrameWriter : public pwx::CLockable {
+    std::deque<sFrame*>       queue;     //!< Pictures waiting for a writer, protected by the lock
+    std::vector<sFrame*>      spare;     //!< Pictures already saved, their memory is reused
+    std::vector<sf::Thread*>  writers;   //!< The writer threads
+    std::atomic<bool>         writing;   //!< The writers run as long as this is true or the queue is not empty
+    bool                      isStalled; //!< Set while push() finds the queue full, so each wait is counted once
+    int32_t                   maxQueue;  //!< Maximum number of pictures in the queue
+    int32_t                   busy;      //!< Number of pictures currently being encoded
+    int64_t                   encoded;   //!< Number of pictures saved so far
+    int64_t                   failed;    //!< Number of pictures that could not be saved
+    int64_t                   stalled;   //!< Number of pictures push() had to refuse at first
+    double                    encSum;    //!< Sum of all encoding times in seconds
+    float                     encLast;   //!< Encoding time of the last picture in seconds
+    float                     encMax;    //!< Longest encoding time in seconds
+    FILE*                     stream;    //!< The stream all pictures go into, NULL if they are saved as files
+    std::vector<uint8_t>      streamBuf; //!< The picture converted for the stream, only used by the writer
+    std::atomic<bool>         streamErr; //!< Set by the writer once writing into the stream failed
+    eStreamFormat             streamFmt; //!< How the pictures are written into the stream
+    int32_t                   streamFps; //!< Frame rate written into the YUV4MPEG2 header
+    bool                      streamHdr; //!< Set once the YUV4MPEG2 header is written
+    CShmRing*                 shmRing;   //!< Ring in shared memory every picture is published in, NULL if there is none
+
+    // The writer thread function, aWriter is this pool:
+    static void writeLoop( void* aWriter );
+
+    // Encode the next picture of the queue, returns false if there was none:
+    bool writeNext( sf::Image& image, sf::Clock& clock );
+
+    // Convert a picture and write it into the stream:
+    bool writeStream( const sFrame& frame );
+
+  public:
+    static const int32_t framesPerWriter = 4; //!< Size of the queue per writer
+
+    /// @brief default ctor, the writers are started by start()
+    explicit CFrameWriter(): writing( false ), isStalled( false ), maxQueue( 0 ), busy( 0 ), encoded( 0 ), failed( 0 ),
+        stalled( 0 ), encSum( 0. ), encLast( 0.f ), encMax( 0.f ), stream( NULL ), streamErr( false ),
+        streamFmt( ESF_Y4M ), streamFps( 0 ), streamHdr( false ), shmRing( NULL ) { }
+
+    // The dtor saves all pictures left and stops the writers:
+    ~CFrameWriter();
+
+    /// @brief return the number of pictures waiting or being encoded
+    int32_t getDepth() {
+        lock();
+        int32_t depth = static_cast<int32_t>( queue.size() ) + busy;
+        unlock();
+        return depth;
+    }
+
+    /// @brief return the encoding time of the last picture in milliseconds
+    float   getEncLast() {
+        lock();
+        float last = 1000.f * encLast;
+        unlock();
+        return last;
+    }
+
+    /// @brief return the maximum number of pictures in the queue
+    int32_t getMaxQueue() const { return maxQueue; }
+
+    /// @brief return true if the stream can not be written any more
+    bool    hasStreamError() const { return streamErr; }
+
+    // Publish all pictures in shared memory instead of files:
+    int32_t openShm( const char* name, int32_t slots, uint32_t width, uint32_t height ) PWX_WARNUNUSED;
+
+    // Write all pictures into a stream instead of files:
+    int32_t openStream( const char* path, eStreamFormat format, int32_t fps ) PWX_WARNUNUSED;
+
+    // Copy a picture into the queue:
+    bool    push( const uint8_t* pixels, uint32_t width, uint32_t height,
+                  const char* name, int32_t number, int64_t second ) PWX_WARNUNUSED;
+
+    // Start the writers:
+    int32_t start( int32_t numWriters ) PWX_WARNUNUSED;
+
+    // Stop the writers once the queue is empty and report what they did:
+    void    stop();
+
+  private:
+    /* --- no copying! --- */
+    CFrameWriter( CFrameWriter& );
+    CFrameWriter& operator=( CFrameWriter& );
+};
+
+#endif // PWX_GRAVMAT_FRAMEWRITER_H_INCLUDED
+
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "hizmap.h"
+#include "tilebins.h"
+
+/// @brief Depth of a cell no mass covers completely, farther than any unit
+const double No_Occluder = std::numeric_limits<double>::max();
+
+
+/** @brief store the depth of all cells the mass disc of @a info covers completely
+  *
+  * projectUnit() draws a mass pixel wherever the distance of the pixel to the
+  * center is less than the view radius. The disc is shrunk by half a pixel, so
+  * rounding can not let a cell count as covered that has a pixel outside.
+  *
+  * @param[in] info The prepared projection of a mass unit
+  * @param[in] minZ The nearest position projectMass() allows
+  * @return true if at least one cell is covered
+**/
+bool CHiZMap::addOccluder( const sProjInfo& info, double minZ ) {
+    double  rad    = info.oR - 0.5;
+    double  radSq  = rad * rad;
+    double  z      = std::max( info.z, minZ ); // projectMass() moves nearer mass pixels to minZ
+    int32_t reach  = static_cast<int32_t>( rad );
+    int32_t cX0    = std::max( info.x - reach, 0 ) >> cellBits;
+    int32_t cY0    = std::max( info.y - reach, 0 ) >> cellBits;
+    int32_t cX1    = std::min( info.x + reach, scrWidth  - 1 ) >> cellBits;
+    int32_t cY1    = std::min( info.y + reach, scrHeight - 1 ) >> cellBits;
+    bool    covers = false;
+
+    for ( int32_t cY = cY0; cY <= cY1; ++cY ) {
+        int32_t top    = cY << cellBits;
+        int32_t bottom = std::min( top + cellSize, scrHeight ) - 1;
+        int32_t dY     = std::max( std::abs( top - info.y ), std::abs( bottom - info.y ) );
+
+        for ( int32_t cX = cX0; cX <= cX1; ++cX ) {
+            int32_t left  = cX << cellBits;
+            int32_t right = std::min( left + cellSize, scrWidth ) - 1;
+            int32_t dX    = std::max( std::abs( left - info.x ), std::abs( right - info.x ) );
+
+            // The pixel farthest from the center decides:
+            if ( static_cast<double>( ( dX * dX ) + ( dY * dY ) ) < radSq ) {
+                double& cell = cells[( cY * levelW[0] ) + cX];
+                if ( z < cell )
+                    cell = z;
+                covers = true;
+            }
+        }
+    }
+
+    return covers;
+}
+
+
+/** @brief build all levels from the prepared projections of all units
+  *
+  * Only units that are not detonation rings hide what lies behind them, these
+  * have a positive oR in their projection.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] info Array of the prepared projections of all units
+  * @param[in] count Number of entries in @a info
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the cells could not be allocated
+**/
+int32_t CHiZMap::build( ENVIRONMENT* env, const sProjInfo* info, int32_t count ) {
+    assert( env && "ERROR: CHiZMap::build() called without valid env!" );
+
+    scrHeight = env->scrHeight;
+    scrWidth  = env->scrWidth;
+    occluders = 0;
+
+    // 1.: Lay out the levels, each halves the number of cells in both directions
+    int32_t cellW     = ( scrWidth  + cellSize - 1 ) >> cellBits;
+    int32_t cellH     = ( scrHeight + cellSize - 1 ) >> cellBits;
+    int32_t cellCount = 0;
+
+    levelPos.clear();
+    levelW.clear();
+    try {
+        while ( true ) {
+            levelPos.push_back( cellCount );
+            levelW.push_back( cellW );
+            cellCount += cellW * cellH;
+            if ( ( 1 == cellW ) && ( 1 == cellH ) )
+                break;
+            cellW = ( cellW + 1 ) / 2;
+            cellH = ( cellH + 1 ) / 2;
+        }
+        cells.assign( cellCount, No_Occluder );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << cellCount << " occlusion cells! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // 2.: Fill the first level
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( info[i].isVisible && ( info[i].oR > 0. ) && addOccluder( info[i], env->universe->M2Pos ) )
+            ++occluders;
+    }
+
+    // 3.: Every further cell is as far as the farthest of its four cells below
+    int32_t levels = static_cast<int32_t>( levelPos.size() );
+    cellH = ( scrHeight + cellSize - 1 ) >> cellBits;
+
+    for ( int32_t lvl = 1; lvl < levels; ++lvl ) {
+        int32_t lowW = levelW[lvl - 1];
+        int32_t lowH = cellH;
+        cellH = ( cellH + 1 ) / 2;
+
+        const double* low  = cells.data() + levelPos[lvl - 1];
+        double*       high = cells.data() + levelPos[lvl];
+
+        for ( int32_t cY = 0; cY < cellH; ++cY ) {
+            int32_t y0 = cY * 2;
+            int32_t y1 = std::min( y0 + 1, lowH - 1 );
+            for ( int32_t cX = 0; cX < levelW[lvl]; ++cX ) {
+                int32_t x0 = cX * 2;
+                int32_t x1 = std::min( x0 + 1, lowW - 1 );
+                high[( cY * levelW[lvl] ) + cX] = std::max( std::max( low[( y0 * lowW ) + x0], low[( y0 * lowW ) + x1] ),
+                                                            std::max( low[( y1 * lowW ) + x0], low[( y1 * lowW ) + x1] ) );
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief return true if every pixel from @a left / @a top to @a right / @a bottom will have a mass not farther than @a z
+  *
+  * The rectangle is inclusive and cut at the plane edges. The level is raised
+  * until the rectangle touches at most two by two cells. A cell of a higher
+  * level covers more pixels than needed, but as it holds the farthest depth of
+  * all of them, the answer can only be false where it could have been true.
+  *
+  * @param[in] left First X-Coordinate
+  * @param[in] top First Y-Coordinate
+  * @param[in] right Last X-Coordinate
+  * @param[in] bottom Last Y-Coordinate
+  * @param[in] z The nearest position anything drawn into the rectangle can have
+  * @return true if nothing drawn there can be visible
+**/
+bool CHiZMap::isHidden( int32_t left, int32_t top, int32_t right, int32_t bottom, double z ) const {
+    if ( 0 == occluders )
+        return false;
+
+    int32_t cX0 = std::max( left,   0 ) >> cellBits;
+    int32_t cY0 = std::max( top,    0 ) >> cellBits;
+    int32_t cX1 = std::min( right,  scrWidth  - 1 );
+    int32_t cY1 = std::min( bottom, scrHeight - 1 );
+
+    if ( ( cX1 < ( cX0 << cellBits ) ) || ( cY1 < ( cY0 << cellBits ) ) )
+        return false;
+    cX1 >>= cellBits;
+    cY1 >>= cellBits;
+
+    int32_t lvl = 0;
+    while ( ( ( cX1 - cX0 ) > 1 ) || ( ( cY1 - cY0 ) > 1 ) ) {
+        cX0 >>= 1;
+        cY0 >>= 1;
+        cX1 >>= 1;
+        cY1 >>= 1;
+        ++lvl;
+    }
+
+    const double* level = cells.data() + levelPos[lvl];
+    for ( int32_t cY = cY0; cY <= cY1; ++cY ) {
+        for ( int32_t cX = cX0; cX <= cX1; ++cX ) {
+            if ( level[( cY * levelW[lvl] ) + cX] > z )
+                return false;
+        }
+    }
+
+    return true;
+}
+
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef PWX_GRAVMAT_HIZMAP_H_INCLUDED
+#define PWX_GRAVMAT_HIZMAP_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+// The occluders are taken from the prepared projections:
+struct sProjInfo;
+
+
+/** @class CHiZMap
+  * @brief Coarse depth of the masses on the projection plane, used to skip hidden units
+  *
+  * The projection plane is cut into cells of cellSize pixels. A cell that lies
+  * completely inside the mass disc of a unit will have a mass pixel at least
+  * as near as the center of that unit in every pixel once it is projected.
+  * build() stores the nearest such depth of every cell, which is the farthest
+  * any mass pixel of the cell can be after the projection.
+  *
+  * The cells are the first level of a pyramid. Every further level holds the
+  * farthest depth of four cells of the level below, until one cell covers the
+  * whole plane. isHidden() looks at the level on which a footprint touches at
+  * most two by two cells, so every test needs at most four reads.
+  *
+  * The map is built from the positions and view radii alone, before any unit
+  * is colored or projected. Every unit is therefore tested against all masses
+  * in front of it, no matter in which order the units are projected.
+**/
+class CHiZMap {
+    std::vector<double>  cells;     //!< The depth of all cells, level by level, each row by row
+    std::vector<int32_t> levelPos;  //!< Start of each level in cells
+    std::vector<int32_t> levelW;    //!< Number of cell columns on each level
+    int32_t              occluders; //!< Number of units that cover at least one cell
+    int32_t              scrHeight; //!< Height of the projection plane the cells cover
+    int32_t              scrWidth;  //!< Width of the projection plane the cells cover
+
+    // Store the depth of all cells the mass disc of a unit covers completely:
+    bool addOccluder( const sProjInfo& info, double minZ ) PWX_WARNUNUSED;
+
+  public:
+    static const int32_t cellBits = 3;             //!< A cell of the first level is 2^cellBits pixels wide
+    static const int32_t cellSize = 1 << cellBits; //!< Edge length of a cell of the first level in pixels
+
+    /// @brief default ctor, the cells are allocated by build()
+    explicit CHiZMap(): occluders( 0 ), scrHeight( 0 ), scrWidth( 0 ) { }
+
+    /// @brief default dtor, does nothing.
+    ~CHiZMap() { }
+
+    // Build all levels from the prepared projections of all units:
+    int32_t build( ENVIRONMENT* env, const sProjInfo* info, int32_t count ) PWX_WARNUNUSED;
+
+    /// @brief return the number of units that cover at least one cell
+    int32_t getOccluders() const { return occluders; }
+
+    // Return true if every pixel from left/top to right/bottom will have a mass not farther than z:
+    bool    isHidden( int32_t left, int32_t top, int32_t right, int32_t bottom, double z ) const PWX_WARNUNUSED;
+
+  private:
+    /* --- no copying! --- */
+    CHiZMap( CHiZMap& );
+    CHiZMap& operator=( CHiZMap& );
+};
+
+#endif // PWX_GRAVMAT_HIZMAP_H_INCLUDED
+
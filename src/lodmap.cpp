@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cmath>
+
+#include "lodmap.h"
+#include "tilebins.h"
+
+
+/// @brief order LOD keys by pixel, depth slice and unit number
+static bool lodLess( const sLodKey& lhs, const sLodKey& rhs ) {
+    if ( lhs.pixel != rhs.pixel )
+        return lhs.pixel < rhs.pixel;
+    if ( lhs.depth != rhs.depth )
+        return lhs.depth < rhs.depth;
+    return lhs.unit < rhs.unit;
+}
+
+
+/** @brief merge all small units sharing a pixel and a depth slice
+  *
+  * Only mass units with a view radius below env->lodRad and the center on the
+  * projection plane are looked at. Detonation rings are never merged.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in,out] info Array of the views prepView() prepared, the impostors are changed in place
+  * @param[in] count Number of entries in @a info
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the keys could not be allocated
+**/
+int32_t CLodMap::build( ENVIRONMENT* env, sProjInfo* info, int32_t count ) {
+    assert( env && "ERROR: CLodMap::build() called without valid env!" );
+
+    impostors = 0;
+    merged    = 0;
+    keys.clear();
+
+    // 1.: Collect all units that can be merged
+    try {
+        for ( int32_t i = 0; i < count; ++i ) {
+            const sProjInfo& curr = info[i];
+            if ( curr.isVisible && ( curr.oR > 0. ) && ( curr.vR < env->lodRad )
+                    && ( curr.x >= 0 ) && ( curr.x < env->scrWidth )
+                    && ( curr.y >= 0 ) && ( curr.y < env->scrHeight ) ) {
+                sLodKey key;
+                key.pixel = ( curr.y * env->scrWidth ) + curr.x;
+                key.depth = static_cast<int32_t>( std::floor( std::log( curr.z ) * depthSlices ) );
+                key.unit  = i;
+                keys.push_back( key );
+            }
+        }
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << count << " LOD keys! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // 2.: Bring the units of each pixel and depth slice together, the first is the impostor
+    std::sort( keys.begin(), keys.end(), lodLess );
+
+    // 3.: Merge every run of units into its first
+    size_t keyCount = keys.size();
+    for ( size_t first = 0, next = 1; first < keyCount; first = next++ ) {
+        while ( ( next < keyCount ) && ( keys[next].pixel == keys[first].pixel )
+                && ( keys[next].depth == keys[first].depth ) )
+            ++next;
+        if ( ( next - first ) < 2 )
+            continue;
+
+        sProjInfo& imp   = info[keys[first].unit];
+        double     mSum  = 0., zSum = 0., mZSum = 0., areaSum = 0.;
+
+        for ( size_t k = first; k < next; ++k ) {
+            sProjInfo& curr = info[keys[k].unit];
+            mSum    += curr.m;
+            zSum    += curr.m * curr.z;
+            mZSum   += curr.m * curr.mZ;
+            areaSum += curr.vR * curr.vR;
+            if ( k > first )
+                curr.isVisible = false;
+        }
+
+        imp.m  = mSum;
+        imp.z  = zSum  / mSum;
+        imp.mZ = mZSum / mSum;
+        imp.vR = std::sqrt( areaSum );
+        imp.oR = imp.vR;
+
+        ++impostors;
+        merged += static_cast<int32_t>( next - first - 1 );
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef PWX_GRAVMAT_LODMAP_H_INCLUDED
+#define PWX_GRAVMAT_LODMAP_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+// The units are merged in their prepared projections:
+struct sProjInfo;
+
+
+/// @brief A unit that can be merged, with the pixel and the depth it is merged by
+struct sLodKey {
+    int32_t pixel; //!< Number of the pixel the unit is drawn at, row by row
+    int32_t depth; //!< Number of the depth slice the unit lies in
+    int32_t unit;  //!< Number of the unit in the prepared projections
+};
+
+
+/** @class CLodMap
+  * @brief Merges units too small to be seen on their own, used with --lod
+  *
+  * A mass unit with a view radius below env->lodRad lights less than one pixel.
+  * All such units drawn at the same pixel are merged into one impostor, if
+  * they lie in the same depth slice. The slices grow with the distance to the
+  * camera, each ends about 13% farther away than it starts, so units far
+  * apart are never merged even if they share a pixel.
+  *
+  * The impostor is the first of the merged units in container order. It gets
+  * their combined mass, the mass-weighted depth and z-movement, and a view
+  * radius that covers the combined area of all of them. The other units are
+  * no longer visible, so every pixel only pays for one mkColor() and one
+  * dust sphere per depth slice, no matter how many units lie behind it.
+**/
+class CLodMap {
+    std::vector<sLodKey> keys;      //!< All units that can be merged, sorted by pixel, depth and unit
+    int32_t              impostors; //!< Number of units that stand in for others
+    int32_t              merged;    //!< Number of units merged into the impostors
+
+  public:
+    static const int32_t depthSlices = 8; //!< Number of depth slices each time the depth grows by a factor of e
+
+    /// @brief default ctor, the keys are allocated by build()
+    explicit CLodMap(): impostors( 0 ), merged( 0 ) { }
+
+    /// @brief default dtor, does nothing.
+    ~CLodMap() { }
+
+    // Merge all small units sharing a pixel and a depth slice:
+    int32_t build( ENVIRONMENT* env, sProjInfo* info, int32_t count ) PWX_WARNUNUSED;
+
+    /// @brief return the number of units that stand in for others
+    int32_t getImpostors() const { return impostors; }
+
+    /// @brief return the number of units merged into the impostors
+    int32_t getMerged() const { return merged; }
+
+  private:
+    /* --- no copying! --- */
+    CLodMap( CLodMap& );
+    CLodMap& operator=( CLodMap& );
+};
+
+#endif // PWX_GRAVMAT_LODMAP_H_INCLUDED
+
@@ -2,6 +2,12 @@
 #ifndef GRAVMAT_MASSPIXEL_H_INCLUDED
 #define GRAVMAT_MASSPIXEL_H_INCLUDED 1
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/// @brief The size of a cache line, the zMaps are aligned to it
+const size_t Cache_Line = 64;
 
 /** @brief simple struct for information on pixels representing masses.
   *
@@ -14,7 +20,8 @@
   *
   * This struct only holds the color and z value. sDustPixel, which
   * derives from this struct, adds some more, dust sphere specific, information,
-  * that are not needed here.
+  * that are not needed here. The zMassMap itself uses sMassWord below.
+  * There are no virtual methods, a pixel is not to carry a vtable pointer.
 **/
 struct sMassPixel {
     uint8_t r; //!< Red value of this pixels color
@@ -23,10 +30,9 @@ struct sMassPixel {
     double  z; //!< Position on a virtual z-axis, where 0.0 is the camera itself, and everything visible is larger than 0.0
 
     explicit sMassPixel():r( 0 ),g( 0 ),b( 0 ),z( -2.0 ) { }
-    virtual ~sMassPixel() { }
 
     /// @brief Invalidate it all
-    virtual void invalidate() {
+    void invalidate() {
         // Note: We can't use setAll(), it would create an endless recursion.
         z = -1.0;
         r = 0;
@@ -35,7 +41,7 @@ struct sMassPixel {
     }
 
     /// @brief set all values or invalidate by setting @a aZ to anything not larger than zero
-    virtual void setAll( double aZ, uint8_t aR, uint8_t aG, uint8_t aB ) {
+    void setAll( double aZ, uint8_t aR, uint8_t aG, uint8_t aB ) {
         if ( aZ > 0. ) {
             z = aZ;
             r = aR;
@@ -59,5 +65,86 @@ struct sMassPixel {
     }
 };
 
+
+/** @brief lock-free pixel of the zMassMap
+  *
+  * The z value and the color of a mass pixel are packed into one 64 bit
+  * word, so the nearest mass can be determined by an atomic minimum without
+  * locking anything. The upper 40 bits hold the depth, the lower 24 bits the
+  * color (r, g, b from high to low).
+  *
+  * The depth is the bit pattern of the (positive) double z cut to its upper
+  * 40 bits. Positive doubles order like their bit patterns, so comparing the
+  * words compares the depths. What is lost are the lower 24 bits of the
+  * mantissa, which is a relative precision of about 4e-9. The stored depth
+  * is always rounded towards the camera.
+  *
+  * An empty pixel has all bits set, which is farther than any depth.
+**/
+struct sMassWord {
+    std::atomic<uint64_t> word; //!< Depth in the upper 40, color in the lower 24 bits
+
+    static const uint64_t colorMask = 0x0000000000ffffffULL; //!< Bits of the color part
+    static const uint64_t noMass    = 0xffffffffffffffffULL; //!< Word of an empty pixel
+
+    explicit sMassWord(): word( noMass ) { }
+
+    /// @brief return the color part of the word
+    void getColor( uint8_t& r, uint8_t& g, uint8_t& b ) const {
+        uint64_t curr = word.load( std::memory_order_relaxed );
+        r = static_cast<uint8_t>( 0xff & ( curr >> 16 ) );
+        g = static_cast<uint8_t>( 0xff & ( curr >>  8 ) );
+        b = static_cast<uint8_t>( 0xff &   curr );
+    }
+
+    /// @brief return the (rounded) z of the mass, or -1.0 if there is none
+    double getZ() const {
+        uint64_t curr = word.load( std::memory_order_relaxed );
+        if ( noMass == curr )
+            return -1.0;
+        double z = 0.;
+        curr &= ~colorMask;
+        memcpy( &z, &curr, sizeof( double ) );
+        return z;
+    }
+
+    /// @brief Invalidate it all
+    void invalidate() {
+        word.store( noMass, std::memory_order_relaxed );
+    }
+
+    /// @brief return the word for @a z (larger than zero) and the color
+    static uint64_t pack( double z, uint8_t r, uint8_t g, uint8_t b ) {
+        uint64_t bits = 0;
+        memcpy( &bits, &z, sizeof( double ) );
+        return ( bits & ~colorMask )
+               | ( static_cast<uint64_t>( r ) << 16 )
+               | ( static_cast<uint64_t>( g ) <<  8 )
+               |   static_cast<uint64_t>( b );
+    }
+
+    /** @brief set z and color if @a z is nearer than the current mass
+      *
+      * This is an atomic minimum over the depth. If the depths are equal,
+      * the mass that came first stays.
+      *
+      * @return true if this is the nearest mass now
+    **/
+    bool setNearer( double z, uint8_t r, uint8_t g, uint8_t b ) {
+        uint64_t next = pack( z, r, g, b );
+        uint64_t curr = word.load( std::memory_order_relaxed );
+        while ( ( next & ~colorMask ) < ( curr & ~colorMask ) ) {
+            if ( word.compare_exchange_weak( curr, next, std::memory_order_relaxed ) )
+                return true;
+        }
+        return false;
+    }
+
+  private:
+    /* --- no copying! --- */
+    sMassWord( sMassWord& );
+    sMassWord& operator=( sMassWord& );
+};
+
 #endif // GRAVMAT_MASSPIXEL_H_INCLUDED
 
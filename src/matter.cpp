@@ -3,8 +3,12 @@
 
 #include "environment.h"
 #include "matter.h"
+#include "colllog.h"
+#include "hizmap.h"
+#include "spherelut.h"
+#include "tilebins.h"
 
-// This one is needed to get RNG Simplex3D offsets:
+// This one is needed to get the simplex offsets:
 #include "sfmlui.h"
 
 // Here the real pixel info headers have to be included
@@ -252,96 +256,198 @@ void CMatter::applyMovement ( ENVIRONMENT* env ) {
 }
 
 
-/// @brief check positions and merge if they collided (Step 6) (returns true if they collide)
-/// Important:this unit must be locked and checked to be not destroyed beforehand
-void CMatter::applyCollision ( ENVIRONMENT* env, CMatter* rhs ) {
-    if ( rhs && ( rhs->mass > 1.0 ) ) {
-        // Two units collide, if their surfaces have a distance less than one meter to each other
-        double dist = pwx::absDistance( posX, posY, posZ, rhs->posX, rhs->posY, rhs->posZ )
-                      - ( env->universe->M2Pos * ( radius + rhs->radius ) );
-        // Note: The result of absDistance is always positive
+/** @brief merge a group of colliding units into its heaviest unit (Step 6)
+  *
+  * The heaviest unit of the group (the first of them if several are equally
+  * heavy) takes the mass of all others, and its impulse and movement become
+  * the averages of all units weighted by their masses. The others are set to
+  * be destroyed. As the units are added up in the order of @a group, the
+  * result is the same no matter which thread does it.
+  *
+  * Important: No other thread may touch the units of the group meanwhile.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] units Array of all units the numbers in @a group refer to
+  * @param[in] group Unit numbers of the group in ascending order
+  * @param[in] count Number of units in @a group
+  * @param[in] log If not NULL, every destroyed unit is recorded there
+  * @param[in] tNum Number of the calling thread, needed by @a log
+  * @param[in] impact If not NULL, the time of impact per unit number, @a log records it
+  * @return the number of units that were merged into the heaviest one
+**/
+int32_t CMatter::applyCollision ( ENVIRONMENT* env, CMatter** units, const int32_t* group, int32_t count,
+                                  CCollLog* log, int32_t tNum, const double* impact ) {
+    CMatter* winner = NULL;
+    double   sumImpX = 0., sumImpY = 0., sumImpZ = 0.;
+    double   sumMovX = 0., sumMovY = 0., sumMovZ = 0.;
+    double   sumMass = 0.;
+    int32_t  result  = 0;
+
+    // 1.: Find the winner and sum up impulses and movements adjusted by their masses
+    for ( int32_t gNr = 0; gNr < count; ++gNr ) {
+        CMatter* unit = units[group[gNr]];
+        if ( unit->destroyed() )
+            continue;
+        if ( !winner || ( unit->mass > winner->mass ) )
+            winner = unit;
+        sumImpX += unit->impX * unit->mass;
+        sumImpY += unit->impY * unit->mass;
+        sumImpZ += unit->impZ * unit->mass;
+        sumMovX += unit->movX * unit->mass;
+        sumMovY += unit->movY * unit->mass;
+        sumMovZ += unit->movZ * unit->mass;
+        sumMass += unit->mass;
+        // The acceleration does not need to be adjusted, as it is regenerated before the next movement
+    }
 
-        rhs->lock();
-        if ( !rhs->destroyed() && ( dist < env->universe->M2Pos ) ) {
-
-            // Set mass and readjust radius on the larger of the two units and set the other to be destroyed:
-            if ( mass >= rhs->mass ) {
-                // This unit "wins" and annihilates rhs
-
-                // The resulting impulse and movement is the average of both movements adjusted by their masses
-                // Note: the final reduction is done later, to save two additions
-                impX = ( impX * mass ) + ( rhs->impX * rhs->mass );
-                impY = ( impY * mass ) + ( rhs->impY * rhs->mass );
-                impZ = ( impZ * mass ) + ( rhs->impZ * rhs->mass );
-                movX = ( movX * mass ) + ( rhs->movX * rhs->mass );
-                movY = ( movY * mass ) + ( rhs->movY * rhs->mass );
-                movZ = ( movZ * mass ) + ( rhs->movZ * rhs->mass );
-                // The acceleration does not need to be adjusted, as it is regenerated before the next movement
-
-                // Add rhs mass now and re-adjust impulse and movement:
-                mass += rhs->mass;
-                impX /= mass;
-                impY /= mass;
-                impZ /= mass;
-                movX /= mass;
-                movY /= mass;
-                movZ /= mass;
-
-                // readjust our radius:
-                setRadius( env );
-
-                // annihilate rhs:
-                rhs->ringMass   = 1.0 + ( mass / 2.0 );
-                rhs->mass       = 0.0; // This takes it out of further calculations until the container is cleaned.
-                rhs->ringRadius = 0.0; // Start with a ring that begins exactly where the mass has ended
-            } else {
-                // rhs "wins" and annihilates this unit
-                rhs->impX = ( impX * mass ) + ( rhs->impX * rhs->mass );
-                rhs->impY = ( impY * mass ) + ( rhs->impY * rhs->mass );
-                rhs->impZ = ( impZ * mass ) + ( rhs->impZ * rhs->mass );
-                rhs->movX = ( movX * mass ) + ( rhs->movX * rhs->mass );
-                rhs->movY = ( movY * mass ) + ( rhs->movY * rhs->mass );
-                rhs->movZ = ( movZ * mass ) + ( rhs->movZ * rhs->mass );
-
-                rhs->mass += mass;
-                rhs->impX /= rhs->mass;
-                rhs->impY /= rhs->mass;
-                rhs->impZ /= rhs->mass;
-                rhs->movX /= rhs->mass;
-                rhs->movY /= rhs->mass;
-                rhs->movZ /= rhs->mass;
-
-                // readjust our radius:
-                rhs->setRadius( env );
-
-                // annihilate this unit:
-                ringMass   = 1.0 + ( rhs->mass / 2.0 );
-                mass       = 0.0; // This takes it out of further calculations until the container is cleaned.
-                ringRadius = 0.0; // Start with a ring that begins exactly where the mass has ended
+    if ( winner ) {
+        // Remember what the merge log needs to know of the winner before the merge
+        const double oldMass = winner->mass;
+        const double oldMovX = winner->movX;
+        const double oldMovY = winner->movY;
+        const double oldMovZ = winner->movZ;
+
+        // 2.: Set mass, impulse and movement of the winner and readjust its radius
+        winner->mass = sumMass;
+        winner->impX = sumImpX / sumMass;
+        winner->impY = sumImpY / sumMass;
+        winner->impZ = sumImpZ / sumMass;
+        winner->movX = sumMovX / sumMass;
+        winner->movY = sumMovY / sumMass;
+        winner->movZ = sumMovZ / sumMass;
+        winner->setRadius( env );
+
+        // 3.: Annihilate all others
+        for ( int32_t gNr = 0; gNr < count; ++gNr ) {
+            CMatter* unit = units[group[gNr]];
+            if ( ( unit != winner ) && !unit->destroyed() ) {
+                if ( log ) {
+                    sCollRecord rec = { env->secondsDone, winner->id, unit->id, oldMass, unit->mass,
+                                        unit->posX, unit->posY, unit->posZ,
+                                        unit->movX - oldMovX, unit->movY - oldMovY, unit->movZ - oldMovZ,
+                                        impact ? impact[group[gNr]] : 1. };
+                    log->record( tNum, rec );
+                }
+                unit->ringMass   = 1.0 + ( sumMass / 2.0 );
+                unit->mass       = 0.0; // This takes it out of further calculations until the container is cleaned.
+                unit->ringRadius = 0.0; // Start with a ring that begins exactly where the mass has ended
+                ++result;
             }
+        }
+    }
 
-            // Note: The position is not added. The positions are considered equal when this annihilation
-            // takes place.
-        } // End of collision handling
-        rhs->unlock();
-    } // End of having rhs
+    // Note: The position is not added. The positions are considered equal when this annihilation
+    // takes place.
+    return result;
 }
 
 
-/// @brief starter method that manages the projection onto the projection plane
-int32_t CMatter::project( ENVIRONMENT* env ) {
-    int32_t result = EXIT_SUCCESS;
-    assert( env && "ERROR: CMatter::project() called without valid env!" );
-    assert( env && env->universe && "ERROR: CMatter::project() called without valid env->universe!" );
+/// @brief return how far the surfaces of this unit and rhs are from being less than one meter apart, in positional coordinates
+double CMatter::getGap ( ENVIRONMENT* env, CMatter* rhs ) const {
+    return pwx::absDistance( posX, posY, posZ, rhs->posX, rhs->posY, rhs->posZ )
+           - ( env->universe->M2Pos * ( radius + rhs->radius + 1. ) );
+}
+
+
+/** @brief return true if the surfaces of this unit and rhs are less than one meter apart (Step 6)
+  *
+  * If env->doSweep is set (--ccd), both units are swept back along their last
+  * movement step, and they collide if they came that close anywhere on the
+  * way. Fast units can then no longer pass through each other between two
+  * checks.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] rhs The unit to check against
+  * @param[out] toi If not NULL, receives the time of impact as the fraction of
+  *             the last step (0.0 = start, 1.0 = current positions)
+  * @return true if both units collide
+**/
+bool CMatter::isColliding ( ENVIRONMENT* env, CMatter* rhs, double* toi ) {
+    bool result = false;
+
+    if ( rhs && ( rhs->mass > 1.0 ) && ( mass > 1.0 ) ) {
+        // Two units collide, if their surfaces have a distance less than one meter to each other
+        double range  = env->universe->M2Pos * ( radius + rhs->radius + 1. );
+        double difX   = posX - rhs->posX;
+        double difY   = posY - rhs->posY;
+        double difZ   = posZ - rhs->posZ;
+        double impact = 1.;
+
+        result = ( ( difX * difX ) + ( difY * difY ) + ( difZ * difZ ) ) < ( range * range );
+
+        if ( env->doSweep ) {
+            /* The relative position over the last step is p(t) = p0 + t * d with t in [0, 1],
+             * d being the relative movement step and p0 the relative position before it.
+             * The first contact is the smaller root of |p(t)|² = range².
+             */
+            double stepMod = env->universe->M2Pos * env->secPFmod;
+            double stpX    = ( movX - rhs->movX ) * stepMod;
+            double stpY    = ( movY - rhs->movY ) * stepMod;
+            double stpZ    = ( movZ - rhs->movZ ) * stepMod;
+            double strX    = difX - stpX;
+            double strY    = difY - stpY;
+            double strZ    = difZ - stpZ;
+            double a       = ( stpX * stpX ) + ( stpY * stpY ) + ( stpZ * stpZ );
+            double b       = 2. * ( ( strX * stpX ) + ( strY * stpY ) + ( strZ * stpZ ) );
+            double c       = ( strX * strX ) + ( strY * strY ) + ( strZ * strZ ) - ( range * range );
+
+            if ( c < 0. ) {
+                // They were touching before the step already
+                impact = 0.;
+                result = true;
+            } else if ( ( b < 0. ) && ( a > 0. ) ) {
+                // They were approaching each other, so look where they met first
+                double disc = ( b * b ) - ( 4. * a * c );
+                if ( disc >= 0. ) {
+                    double t = ( -b - std::sqrt( disc ) ) / ( 2. * a );
+                    if ( t <= 1. ) {
+                        impact = t;
+                        result = true;
+                    }
+                }
+            }
+        } // End of sweeping
+
+        if ( result && toi )
+            *toi = impact;
+    }
+
+    return result;
+}
+
+
+/// @brief let a detonation ring grow after it has been projected
+void CMatter::advanceRing( ENVIRONMENT* env ) {
+    assert( env && env->universe && "ERROR: CMatter::advanceRing() called without valid env->universe!" );
+
+    // The ringRadius is raised for the full time to be x cycles, See UNIVERSE::RingRadIPC
+    if ( ( 1.0 > mass ) && ( ringRadius < env->universe->RingRadMax ) )
+        ringRadius += env->cyclPerFrm * env->universe->RingRadIPC;
+}
+
+
+/** @brief determine where this unit is to be projected
+  *
+  * Only the position and the view radius are determined here, which is all
+  * the CLodMap and the CHiZMap need. prepProject() adds the colors and the
+  * dust sphere.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[out] info Receives the drawing position and the view radius
+  * @return true if the unit touches the projection plane, false otherwise
+**/
+bool CMatter::prepView( ENVIRONMENT* env, sProjInfo& info ) {
+    assert( env && "ERROR: CMatter::prepView() called without valid env!" );
+    assert( env && env->universe && "ERROR: CMatter::prepView() called without valid env->universe!" );
 
     // Shortcuts
-    const double Kg_to_Mass = env->universe->Kg2Mass;
     const double M_to_Pos   = env->universe->M2Pos;
-    const double Pos_to_M   = env->universe->Pos2M;
-    const double Ring_IPC   = env->universe->RingRadIPC; // [I]Increase [P]er [C]ycle
     const double Ring_Max   = env->universe->RingRadMax;
     double viewZpos         = env->dynMaxZ + env->camDist + posZ; // Position on the virtual Z-Axis
 
+    info.unit      = this;
+    info.isVisible = false;
+
     if ( ( viewZpos > 0. )
             && ( ( mass > 1.0 ) || ( ringRadius < Ring_Max ) ) ) {
         double viewXMov = posX + ( M_to_Pos * radius ); // X-Offset by radius
@@ -353,6 +459,9 @@ int32_t CMatter::project( ENVIRONMENT* env ) {
         viewDiv  = env->camDist / ( viewZpos - viewRad );
         // Now it is the divisor that scales units onto the projection plane
 
+        // Only masses hide what lies behind them, and only within their view radius
+        double occlRad = ( 1.0 > mass ) ? 0. : viewRad;
+
         // Before the final viewRad is known, it has to be recalculated if this is a detonation ring:
         if ( 1.0 > mass )
             viewRad += viewRad * ringRadius;
@@ -360,7 +469,7 @@ int32_t CMatter::project( ENVIRONMENT* env ) {
                            + env->halfWidth ); // Absolute drawing position X value
         int32_t viewYpos = static_cast<int32_t>( std::round( posY * viewDiv )
                            + env->halfHeight ); // Absolute drawing position Y value
-        double  dustRad  = viewRad; // Will be modified by mass through mkColor() below
+        double  dustRad  = viewRad; // Will be modified by mass through mkColor() in prepProject()
 
         // There is no need to calculate anything further if this unit doesn't touch the projection plane:
         // Note: This does validate units that are not on the projection plane, because of their diagonal
@@ -368,189 +477,669 @@ int32_t CMatter::project( ENVIRONMENT* env ) {
         // between the units outer rim and the projection plane.
         if ( ( ( viewXpos + dustRad ) > -1 ) && ( ( viewXpos - dustRad ) < env->scrWidth )
                 && ( ( viewYpos + dustRad ) > -1 ) && ( ( viewYpos - dustRad ) < env->scrHeight ) ) {
-            uint8_t r = 0x0, g = 0x0, b = 0x0;
-            double dustMaxRangeMod = 2.5; // The default results in a maximum dust sphere of 40% of the DustMaxRange
-
-            if ( mass > 0.1 ) {
-                double dustRadMassMod = 1.0;
-                env->colorMap->mkColor( Kg_to_Mass * mass, movZ, Pos_to_M * viewZpos,
-                                        &dustRadMassMod, &dustMaxRangeMod,
-                                        r, g, b, 1.0 );
-                dustRad += viewRad * dustRadMassMod;
-                // Note: dustRad was viewRad, and the mod determines, how much larger than the viewRad the dust sphere is
-                if ( dustRad < 1.414214 )
-                    dustRad = 1.414214; // This minimum is there to smooth the display via the 8 pixels around the center
-            } else {
-                env->colorMap->mkColor( Kg_to_Mass * ringMass, 0., Pos_to_M * viewZpos,
-                                        NULL, NULL,
-                                        r, g, b, 1.5 - ( ( Ring_Max - ringRadius ) / Ring_Max ) );
-                dustRad += viewRad; // Here the initial dust radius is always twice the view radius
-            }
-
-            // If the colors are alright now, we can go on
-            assert( ( r || g || b ) && "ERROR: a black unit shall be rendered!" );
-            result = projectUnit( env, viewXpos, viewYpos, viewZpos, viewRad, dustRad, dustMaxRangeMod, r, g, b );
+            info.isVisible = true;
+            info.x         = viewXpos;
+            info.y         = viewYpos;
+            info.z         = viewZpos;
+            info.vR        = viewRad;
+            info.oR        = occlRad;
+            info.m         = mass;
+            info.mZ        = movZ;
         } // End of being on the projection plane
     } // End of being valid to project
 
-    // The ringRadius is raised for the full time to be x cycles, See UNIVERSE::RingRadIPC
-    if ( ( EXIT_SUCCESS == result ) && ( 1.0 > mass ) && ( ringRadius < Ring_Max ) )
-        ringRadius += env->cyclPerFrm * Ring_IPC;
-
-    return result;
+    return info.isVisible;
 }
 
 
-/// @brief return true if x/y/z is NOT hidden behind a mass pixel.
-// Warning: x/y must be ensured to be sane!
-bool CMatter::isFront( ENVIRONMENT* env, int32_t x, int32_t y, double z ) {
-    // Note: z is not checked against 0.0, because env->projectMass/Dust are responsible for that
-    return ( env && ( ( env->zMassMap[x][y].z < 0. ) || ( z < env->zMassMap[x][y].z ) ) );
-}
+/** @brief determine how this unit is to be projected
+  *
+  * @a info must have been prepared by prepView(). Before the color is made, the
+  * unit is tested against the CHiZMap of @a env, if there is one. Nothing of
+  * a unit can be nearer than its center minus 1.2 times the largest dust
+  * radius mkColor() can hand out, because addSimplexOffset() moves a dust pixel
+  * by at most a tenth of its range. If every pixel the unit can reach will
+  * have a mass at least that near, the unit is skipped.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in,out] info Receives the dust radius, the color and the reach
+  * @return true if the unit is to be projected, false if it is off the plane or hidden
+**/
+bool CMatter::prepProject( ENVIRONMENT* env, sProjInfo& info ) {
+    assert( env && "ERROR: CMatter::prepProject() called without valid env!" );
+    assert( env && env->universe && "ERROR: CMatter::prepProject() called without valid env->universe!" );
+    assert( ( this == info.unit ) && "ERROR: CMatter::prepProject() called without prepView()!" );
+
+    if ( !info.isVisible )
+        return false;
 
+    // Shortcuts
+    const double Kg_to_Mass = env->universe->Kg2Mass;
+    const double Pos_to_M   = env->universe->Pos2M;
+    const double Ring_Max   = env->universe->RingRadMax;
+    double       viewRad    = info.vR;
+    double       viewZpos   = info.z;
+
+    // 1.: Skip the unit if it is hidden behind nearer masses
+    if ( env->hiZMap ) {
+        double  hullRad = std::max( viewRad * ( 1.0 + env->colorMap->getMaxDRMod() ),
+                                    std::max( viewRad + 0.6, 1.414214 ) );
+        int32_t reach   = static_cast<int32_t>( std::ceil( 1.1 + hullRad ) ) + 1;
+        if ( env->hiZMap->isHidden( info.x - reach, info.y - reach, info.x + reach, info.y + reach,
+                                    viewZpos - ( 1.2 * hullRad ) ) ) {
+            info.isVisible = false;
+            return false;
+        }
+    }
 
-/// @brief return true if x/y/z is visible.
-bool CMatter::isVisible( ENVIRONMENT* env, int32_t x, int32_t y, double z ) {
-    // Note: z is not checked against 0.0, because env->projectMass/Dust are responsible for that
-    return ( env && isOnPlane( env, x, y ) && isFront( env, x, y, z ) );
-}
+    // 2.: Make the color and the dust sphere
+    uint8_t r = 0x0, g = 0x0, b = 0x0;
+    double  dustRad         = viewRad;
+    double  dustMaxRangeMod = 2.5; // The default results in a maximum dust sphere of 40% of the DustMaxRange
+
+    if ( mass > 0.1 ) {
+        double dustRadMassMod = 1.0;
+        env->colorMap->mkColor( Kg_to_Mass * info.m, info.mZ, Pos_to_M * viewZpos,
+                                &dustRadMassMod, &dustMaxRangeMod,
+                                r, g, b, 1.0 );
+        dustRad += viewRad * dustRadMassMod;
+        // Note: dustRad was viewRad, and the mod determines, how much larger than the viewRad the dust sphere is
+        if ( dustRad < 1.414214 )
+            dustRad = 1.414214; // This minimum is there to smooth the display via the 8 pixels around the center
+    } else {
+        env->colorMap->mkColor( Kg_to_Mass * ringMass, 0., Pos_to_M * viewZpos,
+                                NULL, NULL,
+                                r, g, b, 1.5 - ( ( Ring_Max - ringRadius ) / Ring_Max ) );
+        dustRad += viewRad; // Here the initial dust radius is always twice the view radius
+    }
 
-/// @brief do the projection of each pixel a units projection consists of
-int32_t CMatter::projectUnit( ENVIRONMENT* env, int32_t x, int32_t y, double z, double vR,
-                              double dR, double dMR, uint8_t r, uint8_t g, uint8_t b ) {
-    assert ( ( vR > 0. ) && "ERROR: viewRad MUST be larger than 0.0!" );
-    assert ( ( dR > 0. ) && "ERROR: dustRad MUST be larger than 0.0!" );
+    // If the colors are alright now, we can go on
+    assert( ( r || g || b ) && "ERROR: a black unit shall be rendered!" );
+    info.dR  = dustRad;
+    info.dMR = dustMaxRangeMod;
+    info.r   = r;
+    info.g   = g;
+    info.b   = b;
+    // projectUnit() draws up to 1.1 + dR pixels away, and widens dR of small rings to at most vR + 0.6
+    if ( isSprite( viewRad, dustRad ) )
+        info.reach = 1;
+    else
+        info.reach = static_cast<int32_t>( std::ceil( 1.1 + std::max( dustRad, viewRad + 0.6 ) ) ) + 1;
+
+    return true;
+}
 
-    int32_t result   = EXIT_SUCCESS;
 
-    /* A note on the arguments vR/hR:
-     *
-     * hR is the [h]alo[R]adius and thus the maximum extend of the unit, no matter
-     *   whether it is a mass unit or a detonation ring.
-     * vR is the [v]iew[R]adius and therefore *different* for mass units and detonation
-     *   rings.
-     *   - For mass units vR is the radius the mass has. The area between vR and hR is
-     *     the dust sphere.
-     *   - For detonation ring vR is the radius where the ring _starts_, so it looks
-     *     like being the other way round. On the other hand vR is then the end of the
-     *     central dust sphere representing the consumed mass, so the usage is quite consistent.
-    */
+/** @brief determine the look of the unit from the projection @a info prepProject() prepared
+  *
+  * Everything about the unit projectUnit() and tracePixel() need for every
+  * pixel is calculated here once.
+  *
+  * A note on the radii: vR is the [v]iew[R]adius and therefore *different* for
+  * mass units and detonation rings.
+  * - For mass units vR is the radius the mass has. The area between vR and dR
+  *   is the dust sphere.
+  * - For detonation rings vR is the radius where the ring _starts_, so it looks
+  *   like being the other way round. On the other hand vR is then the end of the
+  *   central dust sphere representing the consumed mass, so the usage is quite consistent.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] info The projection prepared by prepProject()
+  * @param[out] shape Receives the look of the unit
+**/
+void CMatter::prepShape( ENVIRONMENT* env, const sProjInfo& info, sUnitShape& shape ) const {
+    assert ( ( info.vR > 0. ) && "ERROR: viewRad MUST be larger than 0.0!" );
+    assert ( ( info.dR > 0. ) && "ERROR: dustRad MUST be larger than 0.0!" );
 
     // Shortcuts:
     double Half_Radius   = env->universe->RingRadHalf;
     double Full_Radius   = env->universe->RingRadMax;
-
-    // Working values:
-    double  stop     = 1.1 + dR; // This is the maximum offset to calculate
-    double  maxRange = dR * 2. * dMR;
-    double  range    = maxRange;
-    double  colMod   = 1.0;   // Modifier for the color, determined by the position of the pixel relative to the edge
+    double vR            = info.vR;
+    double dR            = info.dR;
+    double dMR           = info.dMR;
+
+    shape.x        = info.x;
+    shape.y        = info.y;
+    shape.z        = info.z;
+    shape.vR       = vR;
+    shape.r        = info.r;
+    shape.g        = info.g;
+    shape.b        = info.b;
+    shape.stop     = 1.1 + dR; // This is the maximum offset to calculate
+    shape.maxRange = dR * 2. * dMR;
 
     // The color has to be "grayed" a bit:
     uint32_t grayPart = static_cast<uint32_t>(
-                            ( static_cast<double>( r )
-                              + static_cast<double>( g )
-                              + static_cast<double>( b ) ) / 3. );
-    uint8_t dustR = static_cast<uint8_t>( 0xff & ( ( grayPart + ( static_cast<uint32_t>( r ) * 2 ) ) / 3 ) );
-    uint8_t dustG = static_cast<uint8_t>( 0xff & ( ( grayPart + ( static_cast<uint32_t>( g ) * 2 ) ) / 3 ) );
-    uint8_t dustB = static_cast<uint8_t>( 0xff & ( ( grayPart + ( static_cast<uint32_t>( b ) * 2 ) ) / 3 ) );
-
+                            ( static_cast<double>( info.r )
+                              + static_cast<double>( info.g )
+                              + static_cast<double>( info.b ) ) / 3. );
+    shape.dustR = static_cast<uint8_t>( 0xff & ( ( grayPart + ( static_cast<uint32_t>( info.r ) * 2 ) ) / 3 ) );
+    shape.dustG = static_cast<uint8_t>( 0xff & ( ( grayPart + ( static_cast<uint32_t>( info.g ) * 2 ) ) / 3 ) );
+    shape.dustB = static_cast<uint8_t>( 0xff & ( ( grayPart + ( static_cast<uint32_t>( info.b ) * 2 ) ) / 3 ) );
 
     // For detonation rings we need five additional values:
-    double centRange = 0., ringRange = 0., ringStop = 0., ringCent = 0.;
-    bool   ringHasMass = true;
+    shape.centRange   = 0.;
+    shape.ringRange   = 0.;
+    shape.ringStop    = 0.;
+    shape.ringCent    = 0.;
+    shape.ringHasMass = true;
 
     if ( 1.0 > mass ) {
         /* This is a detonation ring */
         // centRange is the maxRange value for the central dust sphere representing the consumed
         // mass' dust sphere.
-        centRange  = Full_Radius / ( Full_Radius - ringRadius );
-        if ( centRange < 1.0 )
-            centRange = 1.0;
-        centRange *= vR * 2. * dMR;
+        shape.centRange  = Full_Radius / ( Full_Radius - ringRadius );
+        if ( shape.centRange < 1.0 )
+            shape.centRange = 1.0;
+        shape.centRange *= vR * 2. * dMR;
         // ringStop is the point where the (expanding) ring stops, and is bound to the
         // calculated dust sphere radius. This means that the ring consumes the dust sphere while it
         // expands.
-        ringStop = dR * ( ringRadius / Full_Radius );
-        if ( ringStop < vR ) ringStop = vR + 0.5;
-        if ( dR < ringStop ) dR       = ringStop + 0.1;
+        shape.ringStop = dR * ( ringRadius / Full_Radius );
+        if ( shape.ringStop < vR ) shape.ringStop = vR + 0.5;
+        if ( dR < shape.ringStop ) dR             = shape.ringStop + 0.1;
         // ringCent is the center of the ring at two thirds length towards the ring end.
         // This will make the ring more torus looking and strengthen the expanding effect.
-        ringCent = ( vR / 3. ) + ( ringStop * 2. / 3. );
+        shape.ringCent = ( vR / 3. ) + ( shape.ringStop * 2. / 3. );
         // ringRange is a value needed when the ring radius is larger than half the maximum
         // ring radius. Then the ring is considered a fading dust sphere, fading like the central
         // remnant by increasing the maxRange.
         if ( ringRadius > Half_Radius ) {
-            ringRange = Half_Radius / ( ringRadius - Half_Radius );
-            if ( ringRange < 1.0 )
-                ringRange = 1.0;
-            ringRange *= ringStop - vR * dMR;
+            shape.ringRange = Half_Radius / ( ringRadius - Half_Radius );
+            if ( shape.ringRange < 1.0 )
+                shape.ringRange = 1.0;
+            shape.ringRange *= shape.ringStop - vR * dMR;
             // ringHasMass is used below to easily see if the ring needs color modification or a range
-            ringHasMass = false;
+            shape.ringHasMass = false;
         }
     }
+    shape.dR = dR;
+
+    /* If the view radius of a mass is less than half a pixel, it is considered to
+     * be "outshone" by what is behind it.
+     * the minimum is 50% with a view radius of 0.001 (capped) and the maximum
+     * is 100% (you say!) with a radius of 0.5
+     * Note: The center pixel is then projected as a halo with these ranges, and the
+     *       dimmed dust color is needed by all pixels.
+    */
+    shape.calcRange    = vR < 0.001 ? 0.001 : vR;
+    shape.calcMaxRange = shape.calcRange + ( shape.calcRange * ( 1.0 - ( 2.0 * shape.calcRange ) ) );
+    // Note: This leads of a dust range of maximum 199.8% of vR, which results in 50,05% opacity.
+    if ( ( mass > 0.1 ) && !( vR > 0.5 ) ) {
+        // further the dust color needs to be dimmed:
+        double calcGamma = shape.calcRange / shape.calcMaxRange;
+        shape.dustR = static_cast<uint8_t>( 0xff & static_cast<uint32_t>( std::round( static_cast<double>( shape.dustR ) * calcGamma ) ) );
+        shape.dustG = static_cast<uint8_t>( 0xff & static_cast<uint32_t>( std::round( static_cast<double>( shape.dustG ) * calcGamma ) ) );
+        shape.dustB = static_cast<uint8_t>( 0xff & static_cast<uint32_t>( std::round( static_cast<double>( shape.dustB ) * calcGamma ) ) );
+    }
+}
+
+
+/// @brief starter method that manages the projection of the view @a info prepView() prepared
+int32_t CMatter::project( ENVIRONMENT* env, sProjInfo& info ) {
+    int32_t result = EXIT_SUCCESS;
+
+    if ( prepProject( env, info ) )
+        result = projectUnit( env, info );
+
+    if ( EXIT_SUCCESS == result )
+        advanceRing( env );
+
+    return result;
+}
+
+
+/** @brief project the part of this unit that lies inside @a clip
+  *
+  * No locking is done, the caller must ensure that no other thread
+  * writes into the pixels of @a clip.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] info The projection prepared by prepProject()
+  * @param[in] clip The tile to draw into
+  * @return EXIT_SUCCESS or EXIT_FAILURE if a dust pixel could not be allocated
+**/
+int32_t CMatter::projectTile( ENVIRONMENT* env, const sProjInfo& info, const sTileRect& clip ) {
+    assert( env && "ERROR: CMatter::projectTile() called without valid env!" );
+    assert( info.isVisible && "ERROR: CMatter::projectTile() called for an invisible unit!" );
+
+    return projectUnit( env, info, &clip );
+}
+
+
+/** @brief add the dust sphere part @a z / @a range to @a frags as thrdRay() will see it
+  *
+  * Parts starting behind the camera are moved to it and shortened, parts
+  * completely behind it are left out, like ENVIRONMENT::isDustVisible() does.
+  * Cutting at the mass is done once the nearest mass of the pixel is known.
+**/
+static void addDustFrag( std::vector<sDustFrag>& frags, double z, double range, double maxRange,
+                         uint8_t r, uint8_t g, uint8_t b ) {
+    if ( ( z + range ) < Min_Dust_Range )
+        return;
+    if ( z < Min_Dust_Range ) {
+        range = z + range - Min_Dust_Range;
+        z     = Min_Dust_Range;
+    }
+    sDustFrag frag = { z, z + range, maxRange, r, g, b };
+    frags.push_back( frag );
+}
+
+
+/** @brief determine what this unit shows at the pixel @a x / @a y, used by the ray caster
+  *
+  * This is the same pixel projectUnit() draws at @a x / @a y, but neither
+  * the zMassMap nor the zDustMap are looked at or written. The mass pixel, if
+  * any, is handed back, and the dust sphere parts are added to @a frags. The
+  * caller keeps the nearest mass and cuts the dust at it.
+  *
+  * Note: std::bad_alloc from @a frags is not caught here.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] shape The look of this unit as prepared by prepShape()
+  * @param[in] x X-Coordinate of the pixel
+  * @param[in] y Y-Coordinate of the pixel
+  * @param[out] massZ Receives the position of the mass pixel
+  * @param[out] r Receives the red part of the mass pixel
+  * @param[out] g Receives the green part of the mass pixel
+  * @param[out] b Receives the blue part of the mass pixel
+  * @param[in,out] frags Receives the dust sphere parts of the pixel
+  * @return true if this unit has a mass pixel at @a x / @a y
+**/
+bool CMatter::tracePixel( ENVIRONMENT* env, const sUnitShape& shape, int32_t x, int32_t y,
+                          double& massZ, uint8_t& r, uint8_t& g, uint8_t& b, std::vector<sDustFrag>& frags ) {
+    const double M_to_Pos = env->universe->M2Pos;
+    int32_t      dX       = x - shape.x;
+    int32_t      dY       = y - shape.y;
+    bool         hasMass  = false;
+
+    // 1.: The center pixel
+    if ( ( 0 == dX ) && ( 0 == dY ) ) {
+        double currZ = shape.z - shape.vR;
+        if ( mass > 0.1 ) {
+            uint8_t currR = shape.r;
+            uint8_t currG = shape.g;
+            uint8_t currB = shape.b;
+            addSimplexOffset( env, x, y, currZ, true, false, currR, currG, currB );
+
+            if ( shape.vR > 0.5 ) {
+                hasMass = true;
+                massZ   = std::max( currZ, M_to_Pos );
+                r       = currR;
+                g       = currG;
+                b       = currB;
+            } else
+                addDustFrag( frags, currZ, shape.calcRange, shape.calcMaxRange, currR, currG, currB );
+
+            currZ = shape.z - shape.dR;
+            double currRange = 2. * shape.dR;
+            addSimplexOffset( env, x, y, currZ, true, false, currRange );
+            addDustFrag( frags, currZ, currRange, shape.maxRange, shape.dustR, shape.dustG, shape.dustB );
+        } else {
+            double xRange = shape.vR * 2.;
+            addSimplexOffset( env, x, y, currZ, true, false, xRange );
+            addDustFrag( frags, currZ, xRange, shape.centRange, shape.dustR, shape.dustG, shape.dustB );
+        }
+        return hasMass;
+    }
+
+    // 2.: Sub-pixel units only reach the eight neighbours, see projectSprite()
+    if ( isSprite( shape.vR, shape.dR ) && ( ( std::abs( dX ) > 1 ) || ( std::abs( dY ) > 1 ) ) )
+        return false;
+
+    // 3.: Find the offset of the quarter projectUnit() mirrors onto this pixel
+    int32_t xIdx, yIdx;
+    if      ( ( dX >  0 ) && ( dY >= 0 ) ) { xIdx =  dX; yIdx =  dY; }
+    else if ( ( dX <= 0 ) && ( dY >  0 ) ) { xIdx =  dY; yIdx = -dX; }
+    else if ( ( dX <  0 ) && ( dY <= 0 ) ) { xIdx = -dX; yIdx = -dY; }
+    else                                   { xIdx = -dY; yIdx =  dX; }
+
+    sUnitPixel pix;
+    if ( !( static_cast<double>( xIdx ) < shape.stop ) || !( static_cast<double>( yIdx ) < shape.stop )
+            || !getPixel( env, shape, xIdx, yIdx, pix ) )
+        return false;
+
+    // 4.: The mass pixel
+    if ( pix.isMassPix || ( pix.isRingPix && shape.ringHasMass ) ) {
+        r = pix.r;
+        g = pix.g;
+        b = pix.b;
+        addSimplexOffset( env, x, y, pix.massZ, pix.isMassPix, pix.isRingPix, r, g, b );
+        hasMass = true;
+        massZ   = std::max( pix.massZ, M_to_Pos );
+    }
+
+    // 5.: The dust pixel
+    if ( pix.isDustPix || pix.isRemnPix || ( pix.isRingPix && !shape.ringHasMass ) ) {
+        double currRange = pix.range;
+        double currZ     = pix.dustZ;
+        addSimplexOffset( env, x, y, currZ, pix.isDustPix || pix.isRemnPix, pix.isRingPix, currRange );
+        addDustFrag( frags, currZ, currRange, pix.maxRange, shape.dustR, shape.dustG, shape.dustB );
+    }
+
+    return hasMass;
+}
+
+
+/// @brief return true if x/y/z is NOT hidden behind a mass pixel.
+// Warning: x/y must be ensured to be sane!
+bool CMatter::isFront( ENVIRONMENT* env, int32_t x, int32_t y, double z ) {
+    // Note: z is not checked against 0.0, because env->projectMass/Dust are responsible for that
+    double massZ = env->zMassMap[y][x].getZ();
+    return ( ( massZ < 0. ) || ( z < massZ ) );
+}
+
+
+/// @brief return true if there is no @a clip or x/y are inside it
+bool CMatter::isInClip( const sTileRect* clip, int32_t x, int32_t y ) {
+    return ( !clip || ( ( x >= clip->left ) && ( x < clip->right ) && ( y >= clip->top ) && ( y < clip->bottom ) ) );
+}
+
+
+/// @brief return true if x/y/z is visible.
+bool CMatter::isVisible( ENVIRONMENT* env, int32_t x, int32_t y, double z ) {
+    // Note: z is not checked against 0.0, because env->projectMass/Dust are responsible for that
+    return ( env && isOnPlane( env, x, y ) && isFront( env, x, y, z ) );
+}
+
+/** @brief determine what the unit of @a shape shows at the offset @a xIdx / @a yIdx from its center
+  *
+  * The offsets are those of the quarter projectUnit() mirrors by both axis, so
+  * @a xIdx is at least 1 and @a yIdx at least 0. The simplex offsets are not
+  * added here, they depend on the pixel the offset is mirrored to.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] shape The look of the unit as prepared by prepShape()
+  * @param[in] xIdx X-Offset of the pixel from the center
+  * @param[in] yIdx Y-Offset of the pixel from the center
+  * @param[out] pix Receives the mass and the dust sphere part of the pixel
+  * @return true if the pixel is part of the unit, false otherwise
+**/
+bool CMatter::getPixel( ENVIRONMENT* env, const sUnitShape& shape, int32_t xIdx, int32_t yIdx, sUnitPixel& pix ) const {
+    const CSphereLUT* Profile = env->sphereLut;
+    const double      vR      = shape.vR;
+    const double      dR      = shape.dR;
+
+    /* There are three steps before we can project the points:
+     * Step 1: calculate the distance values of this pixel
+     * Step 2: determine the case and the resulting mod and drawing Z values
+     * Step 3: calculate colmod if it is needed
+    */
+
+    /* === Step 1: Calculate the distance value of this pixel ===
+       ===----------------------------------------------------===
+    pointDist is the simple distance between pixel and the center. The simple distance determines
+    the "phase" the pixel is in.
+    */
+    double pointDist = Profile->getPointDist( xIdx, yIdx ); // Distance of the center of the pixel to 0/0
+
+    /* === Step 2: Set the case we are in. Calculate mod and drawing Z ===
+       ===-------------------------------------------------------------===
+    It is not only necessary to know in which part (or "phase") of an object we are,
+    all parts share two values that are needed to project the resulting pixels.
+    modZ is a multiplier for the specific radius of the sphere that allows to calculate
+    massZ and dustZ. The two Z positions are the z nearer to the camera than the argument z
+    where the pixel (or point) truly lies. Further more dust sphere pixels need their range,
+    which is twice the z-offset of this pixel.
+    */
+    double modZ    = 0.;
+
+    pix.isMassPix = false;
+    pix.isRemnPix = false;
+    pix.isRingPix = false;
+    pix.isDustPix = false;
+    pix.dustZ     = shape.z;
+    pix.massZ     = shape.z;
+    pix.range     = shape.maxRange;
+    pix.maxRange  = shape.maxRange;
+
+    if ( pointDist < vR ) {
+        /* A note about modZ:
+         * modZ is the cosine of the angle between the hypotenuse (0/0 to x/y) and the
+         * z-offset (z - massZ) of this point. pointDist is this hypotenuse, and can
+         * be used to calculate the sine of said angle. modZ is then the cosine of that
+         * angle that we get by simply calculating the arcus sine. As cos(asin(t)) is
+         * sqrt(1 - t²), CSphereLUT::getModZ() does that without any trigonometry.
+        */
+
+        // This pixel is within the inner bounds, so either it is the mass or its remnant
+        if ( mass > 0.1 ) {
+            // Here we have to add the spanning sphere
+            pix.isDustPix = true;
+            modZ       = Profile->getModZ( pointDist / dR );
+            pix.range  = 2 * dR * modZ;
+            pix.dustZ -= dR * modZ;
+
+            // Note: The dust pixel is calculated first, because modZ is later
+            // needed for the color modification of the mass pixel
+            pix.isMassPix = true;
+            modZ       = Profile->getModZ( pointDist / vR );
+            pix.massZ -= vR * modZ;
+        } else {
+            pix.isRemnPix = true;
+            modZ         = Profile->getModZ( pointDist / vR );
+            pix.dustZ   -= vR * modZ;
+            pix.range    = 2 * vR * modZ;
+            pix.maxRange = shape.centRange;
+        }
+    } // End of having a pixel in the inner bounds
+    else if ( ( 1.0 > mass ) && ( pointDist < shape.ringStop ) ) {
+        pix.isRingPix = true;
+        pix.maxRange  = shape.ringRange;
+        /* This is a bit more complicated, because the ring is a torus with shifted center.
+         * Generally speaking the ring consist of two half tori. The inner and the outer.
+         * As we "see" a point on a line through the torus, only the side off the center
+         * and that respective distance are relevant.
+        */
+        if ( pointDist < shape.ringCent ) {
+            // Inner half
+            double innRad = shape.ringCent - vR;
+            modZ      = Profile->getModZ( 1.0 - ( ( pointDist - vR ) / innRad ) );
+            pix.range = 2 * innRad * modZ;
+            if ( shape.ringHasMass )
+                pix.massZ -= innRad * modZ;
+            else
+                pix.dustZ -= innRad * modZ;
+        } else {
+            // Outer half
+            double outRad = shape.ringStop - shape.ringCent;
+            modZ      = Profile->getModZ( ( pointDist - shape.ringCent ) / outRad );
+            pix.range = 2 * outRad * modZ;
+            if ( shape.ringHasMass )
+                pix.massZ -= outRad * modZ;
+            else
+                pix.dustZ -= outRad * modZ;
+        }
+    } // End of having a pixel in the detonation ring
+    else if ( pointDist < dR ) {
+        // Simple. Same as with the inner bounds, but with dR instead of vR
+        pix.isDustPix = true;
+        modZ       = Profile->getModZ( pointDist / dR );
+        pix.range  = 2 * dR * modZ;
+        pix.dustZ -= dR * modZ;
+    } // End of having a pixel in the dust sphere
+    else
+        // None of these is true, the pixel is not part of the unit
+        return false;
+
+    /* === Step 3: Calculate colmod if this is a mass representing pixel ===
+       ===---------------------------------------------------------------===
+    */
+    pix.r = shape.r;
+    pix.g = shape.g;
+    pix.b = shape.b;
+
+    if ( pix.isMassPix || ( shape.ringHasMass && pix.isRingPix ) ) {
+        double colMod   = 1.0; // Modifier for the color, determined by the position of the pixel relative to the edge
+        double edgeDist = Profile->getEdgeDist( xIdx, yIdx );
+        // Note: We calculate the bottom right quarter of an object and mirror the results.
+        if ( pix.isMassPix )
+            colMod = 1.0 - ( ( edgeDist / vR ) / 4. ) // relative distance to the center
+                     + ( ( vR - pointDist ) / 2. ); // Real point distance to the radius
+        else {
+            if ( pointDist < shape.ringCent )
+                colMod = 1.0 - ( ( vR / edgeDist ) / 4. ) // relative distance to the center
+                         + ( ( pointDist - vR ) / 2. ); // Real point distance to the radius
+            else
+                colMod = 1.0 - ( ( edgeDist / shape.ringStop ) / 4. ) // relative distance to the center
+                         + ( ( shape.ringStop - pointDist ) / 2. ); // Real point distance to the radius
+        }
+
+        // Now that we have modZ and colMod, we can further manipulate colMod
+        if ( colMod > 1.00 ) colMod = 1.00;
+        colMod *= 1.0 - ( 0.5 - ( modZ / 2. ) );
+        // This means, that the color is lowered by 50% at the outer edge, and 0% at the center
+
+        // Normalize lower boundary:
+        if ( colMod < 0.25 ) colMod = 0.25;
+
+        // Finally colMod is applied to the base color:
+        pix.r = static_cast<uint8_t>( std::round( static_cast<double>( shape.r ) * colMod ) );
+        pix.g = static_cast<uint8_t>( std::round( static_cast<double>( shape.g ) * colMod ) );
+        pix.b = static_cast<uint8_t>( std::round( static_cast<double>( shape.b ) * colMod ) );
+    }
+
+    return true;
+}
+
+
+/** @brief project the dust sphere of a sub-pixel unit onto the eight neighbours of its center
+  *
+  * A unit for which isSprite() is true has no mass pixel beyond the center,
+  * and its dust sphere does not reach further than the eight neighbours. The
+  * four neighbours at the sides share one profile, the four at the corners
+  * another, so each is calculated once. The pixels are projected in the same
+  * order the offset loops of projectUnit() would use, so the result is the same.
+  *
+  * Without @a clip every pixel is written under the lock of @a env. With
+  * @a clip only the pixels inside it are written, and no locking is done.
+**/
+int32_t CMatter::projectSprite( ENVIRONMENT* env, const sUnitShape& shape, const sTileRect* clip ) {
+    const int32_t x  = shape.x;
+    const int32_t y  = shape.y;
+    const double  dR = shape.dR;
+
+    // The sides first, then the corners, each clockwise starting to the right
+    const int32_t spriteX[8] = { x + 1, x,     x - 1, x,     x + 1, x - 1, x - 1, x + 1 };
+    const int32_t spriteY[8] = { y,     y + 1, y,     y - 1, y + 1, y + 1, y - 1, y - 1 };
+
+    int32_t result      = EXIT_SUCCESS;
+    bool    hasPix[2]   = { false, false };
+    double  pixZ[2]     = { shape.z, shape.z };
+    double  pixRange[2] = { 0., 0. };
+
+    // 1.: The profile of the sides (offset 1/0) and the corners (offset 1/1)
+    for ( int32_t pNr = 0; pNr < 2; ++pNr ) {
+        double pointDist = env->sphereLut->getPointDist( 1, pNr );
+        if ( pointDist < dR ) {
+            double modZ   = CSphereLUT::getModZ( pointDist / dR );
+            hasPix[pNr]   = true;
+            pixRange[pNr] = 2 * dR * modZ;
+            pixZ[pNr]    -= dR * modZ;
+        }
+    }
+
+    // 2.: Project the dust pixels
+    for ( int32_t i = 0; ( EXIT_SUCCESS == result ) && ( i < 8 ); ++i ) {
+        int32_t pNr = i / 4;
+        if ( hasPix[pNr] && isOnPlane( env, spriteX[i], spriteY[i] ) && isInClip( clip, spriteX[i], spriteY[i] ) ) {
+            if ( !clip ) env->lock();
+            if ( isVisible( env, spriteX[i], spriteY[i], pixZ[pNr] ) ) {
+                double currRange = pixRange[pNr];
+                double currZ     = pixZ[pNr];
+                addSimplexOffset( env, spriteX[i], spriteY[i], currZ, true, false, currRange );
+
+                // If the range is shortened, currZ is moved a bit away. We therefore have to check again:
+                if ( ( currRange > Min_Dust_Range ) && isFront( env, spriteX[i], spriteY[i], currZ ) )
+                    result = env->projectDust( spriteX[i], spriteY[i], currZ, shape.dustR, shape.dustG, shape.dustB,
+                                               currRange, shape.maxRange );
+            }
+            if ( !clip ) env->unlock();
+        }
+    }
+
+    return result;
+}
+
+
+/** @brief do the projection of each pixel a units projection consists of
+  *
+  * Without @a clip every pixel is written under the lock of @a env. With
+  * @a clip only the pixels inside it are written, and no locking is done.
+**/
+int32_t CMatter::projectUnit( ENVIRONMENT* env, const sProjInfo& info, const sTileRect* clip ) {
+    int32_t    result = EXIT_SUCCESS;
+    sUnitShape shape;
+
+    prepShape( env, info, shape );
+
+    // Shortcuts:
+    const int32_t x  = shape.x;
+    const int32_t y  = shape.y;
+    const double  z  = shape.z;
+    const double  vR = shape.vR;
+    const double  dR = shape.dR;
 
     // The first thing we have to do is to project the center pixel. This is done beforehand,
     // because it would be too much of a hassle to skip one of the zero coordinates in each run.
     // very large objects near to the camera need a lot of pixels to consider, doing superfluous
     // checks every time is not very effective. And finally the drawing of the center pixel is simple.
-    env->lock();
-    if ( isVisible( env, x, y, z - vR ) ) {
+    if ( !clip ) env->lock();
+    if ( isInClip( clip, x, y ) && isVisible( env, x, y, z - vR ) ) {
         double  currZ = z - vR;
         if ( mass > 0.1 ) {
             // 1: The mass pixel preparation
-            uint8_t currR = r;
-            uint8_t currG = g;
-            uint8_t currB = b;
+            uint8_t currR = shape.r;
+            uint8_t currG = shape.g;
+            uint8_t currB = shape.b;
             addSimplexOffset( env, x, y, currZ, true, false, currR, currG, currB );
 
             // 2.: Project the pixel as a mass
             if ( vR > 0.5 )
                 env->projectMass( x, y, currZ, currR, currG, currB );
-            // 3.: Project the pixel as a halo
-            else {
-                /* If the view radius is less than half a pixel, it is considered to
-                 * be "outshone" by what is behind it.
-                 * the minimum is 50% with a view radius of 0.001 (capped) and the maximum
-                 * is 100% (you say!) with a radius of 0.5
-                */
-                double calcRange = vR < 0.001 ? 0.001 : vR;
-                double calcMaxRange = calcRange + ( calcRange * ( 1.0 - ( 2.0 * calcRange ) ) );
-                // Note: This leads of a dust range of maximum 199.8% of vR, which results in 50,05% opacity.
-
-                // further the dust color needs to be dimmed:
-                double calcGamma = calcRange / calcMaxRange;
-                dustR = static_cast<uint8_t>( 0xff & static_cast<uint32_t>( std::round( static_cast<double>( dustR ) * calcGamma ) ) );
-                dustG = static_cast<uint8_t>( 0xff & static_cast<uint32_t>( std::round( static_cast<double>( dustG ) * calcGamma ) ) );
-                dustB = static_cast<uint8_t>( 0xff & static_cast<uint32_t>( std::round( static_cast<double>( dustB ) * calcGamma ) ) );
-
-                // Now project the pixel
-                result = env->projectDust( x, y, currZ, currR, currG, currB, calcRange, calcMaxRange );
-            }
+            // 3.: Project the pixel as a halo, see prepShape()
+            else
+                result = env->projectDust( x, y, currZ, currR, currG, currB, shape.calcRange, shape.calcMaxRange );
 
             // 4.: The dust pixel
             if ( EXIT_SUCCESS == result ) {
                 currZ = z - dR;
                 double currRange = 2. * dR;
                 addSimplexOffset( env, x, y, currZ, true, false, currRange );
-                result = env->projectDust( x, y, currZ, dustR, dustG, dustB, currRange, maxRange );
+                result = env->projectDust( x, y, currZ, shape.dustR, shape.dustG, shape.dustB, currRange, shape.maxRange );
             }
         } else {
             double xRange = vR * 2.;
             addSimplexOffset( env, x, y, currZ, true, false, xRange );
-            result = env->projectDust( x, y, currZ, dustR, dustG, dustB, xRange, centRange );
+            result = env->projectDust( x, y, currZ, shape.dustR, shape.dustG, shape.dustB, xRange, shape.centRange );
         }
     } // End of having no mass point in front of this one
     // Quit if we failed:
     if ( EXIT_FAILURE == result )
         env->doWork = false;
     // Now unlock
-    env->unlock();
+    if ( !clip ) env->unlock();
+
+    // Sub-pixel units only reach the eight neighbours with their dust sphere, the loops are not needed for them
+    if ( isSprite( vR, dR ) ) {
+        if ( env->doWork )
+            result = projectSprite( env, shape, clip );
+        return result;
+    }
 
     // Now we can calculate everything else in a two level loop, mirroring the result by both axis
     // Note: If the result of a dust projection is EXIT_FAILURE, then env->doWork is already false.
-    for ( double xOff = 1.0; ( xOff < stop ) && env->doWork; xOff += 1.0 ) {
-        for ( double yOff = 0.0; ( yOff < stop ) && env->doWork; yOff += 1.0 ) {
+    for ( double xOff = 1.0; ( xOff < shape.stop ) && env->doWork; xOff += 1.0 ) {
+        // With a clip, the whole row is skipped if none of the four mirrored lines crosses it:
+        if ( clip ) {
+            int32_t off = static_cast<int32_t>( xOff );
+            if ( !( ( ( x + off ) >= clip->left ) && ( ( x + off ) < clip->right ) )
+                    && !( ( ( x - off ) >= clip->left ) && ( ( x - off ) < clip->right ) )
+                    && !( ( ( y + off ) >= clip->top  ) && ( ( y + off ) < clip->bottom ) )
+                    && !( ( ( y - off ) >= clip->top  ) && ( ( y - off ) < clip->bottom ) ) )
+                continue;
+        }
+        for ( double yOff = 0.0; ( yOff < shape.stop ) && env->doWork; yOff += 1.0 ) {
             int32_t drawX[4]  = { static_cast<int32_t>( std::round( x + xOff ) ),
                                   static_cast<int32_t>( std::round( x - yOff ) ),
                                   static_cast<int32_t>( std::round( x - xOff ) ),
@@ -563,190 +1152,47 @@ int32_t CMatter::projectUnit( ENVIRONMENT* env, int32_t x, int32_t y, double z,
                                 };
             // Note: Use isOnPlane() rather than isVisible(), because the latter needs the real z value
             // and that value needs a lot of calculations beforehand we can save here.
-            bool    doDraw[4] = { isOnPlane( env, drawX[0], drawY[0] ),
-                                  isOnPlane( env, drawX[1], drawY[1] ),
-                                  isOnPlane( env, drawX[2], drawY[2] ),
-                                  isOnPlane( env, drawX[3], drawY[3] )
+            bool    doDraw[4] = { isOnPlane( env, drawX[0], drawY[0] ) && isInClip( clip, drawX[0], drawY[0] ),
+                                  isOnPlane( env, drawX[1], drawY[1] ) && isInClip( clip, drawX[1], drawY[1] ),
+                                  isOnPlane( env, drawX[2], drawY[2] ) && isInClip( clip, drawX[2], drawY[2] ),
+                                  isOnPlane( env, drawX[3], drawY[3] ) && isInClip( clip, drawX[3], drawY[3] )
                                 };
-
-            // Now do only continue if at least one of the 4 pixels is drawable:
-            if ( doDraw[0] || doDraw[1] || doDraw[2] || doDraw[3] ) {
-                /* There are three steps before we can project the points:
-                 * Step 1: calculate the distance values of this pixel
-                 * Step 2: determine the case and the resulting mod and drawing Z values
-                 * Step 3: calculate colmod if it is needed
-                */
-
-                /* === Step 1: Calculate the distance value of this pixel ===
-                   ===----------------------------------------------------===
-                pointDist is the simple distance between pixel and the center. The simple distance determines
-                the "phase" the pixel is in.
-                */
-                double pointDist = pwx::absDistance( xOff, yOff, 0., 0. ); // Distance of the center of the pixel to 0/0
-
-                /* === Step 2: Set the case we are in. Calculate mod and drawing Z ===
-                   ===-------------------------------------------------------------===
-                It is not only necessary to know in which part (or "phase") of an object we are,
-                all parts share two values that are needed to project the resulting pixels.
-                modZ is a multiplier for the specific radius of the sphere that allows to calculate
-                massZ and dustZ. The two Z positions are the z nearer to the camera than the argument z
-                where the pixel (or point) truly lies. Further more dust sphere pixels need their range,
-                which is twice the z-offset of this pixel.
-                */
-                bool isMassPix = false, isRemnPix = false, isRingPix = false, isDustPix = false;
-                double dustZ   = z;
-                double massZ   = z;
-                double modZ    = 0.;
-
-                if ( pointDist < vR ) {
-                    /* A note about modZ:
-                     * modZ is the cosine of the angle between the hypotenuse (0/0 to x/y) and the
-                     * z-offset (z - massZ) of this point. pointDist is this hypotenuse, and can
-                     * be used to calculate the sine of said angle. modZ is then the cosine of that
-                     * angle that we get by simply calculating the arcus sine. We do not use SCT.cos,
-                     * because asin() returns radians, which std::cos happily takes.
-                    */
-
-                    // This pixel is within the inner bounds, so either it is the mass or its remnant
-                    if ( mass > 0.1 ) {
-                        // Here we have to add the spanning sphere
-                        isDustPix = true;
-                        modZ   = std::cos( std::asin( pointDist / dR ) );
-                        range  = 2 * dR * modZ;
-                        dustZ -= dR * modZ;
-
-                        // Note: The dust pixel is calculated first, because modZ is later
-                        // needed for the color modification of the mass pixel
-                        isMassPix = true;
-                        modZ   = std::cos( std::asin( pointDist / vR ) );
-                        massZ -= vR * modZ;
-                    } else {
-                        isRemnPix = true;
-                        modZ   = std::cos( std::asin( pointDist / vR ) );
-                        dustZ -= vR * modZ;
-                        range  = 2 * vR * modZ;
-                    }
-                } // End of having a pixel in the inner bounds
-                else if ( ( 1.0 > mass ) && ( pointDist < ringStop ) ) {
-                    isRingPix = true;
-                    /* This is a bit more complicated, because the ring is a torus with shifted center.
-                     * Generally speaking the ring consist of two half tori. The inner and the outer.
-                     * As we "see" a point on a line through the torus, only the side off the center
-                     * and that respective distance are relevant.
-                    */
-                    if ( pointDist < ringCent ) {
-                        // Inner half
-                        double innRad = ringCent - vR;
-                        modZ   = std::cos( std::asin( 1.0 - ( ( pointDist - vR ) / innRad ) ) );
-                        range  = 2 * innRad * modZ;
-                        if ( ringHasMass )
-                            massZ -= innRad * modZ;
-                        else
-                            dustZ -= innRad * modZ;
-                    } else {
-                        // Outer half
-                        double outRad = ringStop - ringCent;
-                        modZ   = std::cos( std::asin( ( pointDist - ringCent ) / outRad ) );
-                        range  = 2 * outRad * modZ;
-                        if ( ringHasMass )
-                            massZ -= outRad * modZ;
-                        else
-                            dustZ -= outRad * modZ;
-                    }
-                } // End of having a pixel in the detonation ring
-                else if ( pointDist < dR ) {
-                    // Simple. Same as with the inner bounds, but with hR instead of vR
-                    isDustPix = true;
-                    modZ   = std::cos( std::asin( pointDist / dR ) );
-                    range  = 2 * dR * modZ;
-                    dustZ -= dR * modZ;
-                } // End of having a pixel in the dust sphere
-                // No else, if none of these is true, we are finished now and do not carry on below.
-
-                if ( isMassPix || isRemnPix || isRingPix || isDustPix ) {
-                    /* === Step 3: Calculate colmod if this is a mass representing pixel ===
-                       ===---------------------------------------------------------------===
-                    */
-
-                    if ( isMassPix || ( ringHasMass && isRingPix ) ) {
-                        double edgeDist  = pwx::absDistance(
-                                               xOff + ( -0.5 *
-                                                        ( static_cast<int32_t>( yOff ) > static_cast<int32_t>( xOff ) ?
-                                                          xOff / yOff : 1.0 ) ), // Move from left to center the further down the pixel is
-                                               yOff + ( -0.5 *
-                                                        ( static_cast<int32_t>( xOff ) > static_cast<int32_t>( yOff ) ?
-                                                          yOff / xOff : 1.0 ) ), // Move from top to center the further right the pixel is
-                                               0., 0. ); // The center
-                        // Note: We calculate the bottom right quarter of an object and mirror the results.
-                        if ( isMassPix )
-                            colMod = 1.0 - ( ( edgeDist / vR ) / 4. ) // relative distance to the center
-                                     + ( ( vR - pointDist ) / 2. ); // Real point distance to the radius
-                        else {
-                            if ( pointDist < ringCent )
-                                colMod = 1.0 - ( ( vR / edgeDist ) / 4. ) // relative distance to the center
-                                         + ( ( pointDist - vR ) / 2. ); // Real point distance to the radius
-                            else
-                                colMod = 1.0 - ( ( edgeDist / ringStop ) / 4. ) // relative distance to the center
-                                         + ( ( ringStop - pointDist ) / 2. ); // Real point distance to the radius
-                        }
-
-                        // Now that we have modZ and colMod, we can further manipulate colMod
-                        if ( colMod > 1.00 ) colMod = 1.00;
-                        colMod *= 1.0 - ( 0.5 - ( modZ / 2. ) );
-                        // This means, that the color is lowered by 50% at the outer edge, and 0% at the center
-
-                        // Normalize lower boundary:
-                        if ( colMod < 0.25 ) colMod = 0.25;
-                    }
-
-
-                    /* === Step 5: Generate final color and project this pixel ===
-                     * ===-----------------------------------------------------===
-                    Before we go through the pixels to be drawn, the resulting color has to be determined:
-                    */
-                    uint8_t baseR = r, baseG = g, baseB = b;
-
-                    if ( isMassPix || ( isRingPix && ringHasMass ) ) {
-                        // Here colMod is needed to be applied to the base color:
-                        baseR = static_cast<uint8_t>( std::round( static_cast<double>( r ) * colMod ) );
-                        baseG = static_cast<uint8_t>( std::round( static_cast<double>( g ) * colMod ) );
-                        baseB = static_cast<uint8_t>( std::round( static_cast<double>( b ) * colMod ) );
-                    }
-
-                    for ( int32_t i = 0; i < 4; ++i ) {
-                        env->lock();
-                        if ( doDraw[i] ) {
-                            // Project mass pixel first
-                            if ( ( isMassPix || ( isRingPix && ringHasMass ) )
-                                    && isVisible( env, drawX[i], drawY[i], massZ ) ) {
-                                uint8_t currR = baseR;
-                                uint8_t currG = baseG;
-                                uint8_t currB = baseB;
-                                addSimplexOffset( env, drawX[i], drawY[i], massZ, isMassPix, isRingPix, currR, currG, currB );
-                                env->projectMass( drawX[i], drawY[i], massZ, currR, currG, currB );
-                            } // End of having a mass pixel
-
-                            // Now project the dust pixel if there is one
-                            if ( ( isDustPix || isRemnPix || ( isRingPix && !ringHasMass ) )
-                                    && isVisible( env, drawX[i], drawY[i], dustZ ) ) {
-                                double currRange = range;
-                                addSimplexOffset( env, drawX[i], drawY[i], dustZ, isDustPix || isRemnPix, isRingPix, currRange );
-
-                                // If the range is shortened, dustZ is moved a bit away. We therefore have to check again:
-                                if ( ( currRange > Min_Dust_Range ) && isFront( env, drawX[i], drawY[i], dustZ ) ) {
-                                    if      ( isRemnPix )
-                                        result = env->projectDust( drawX[i], drawY[i], dustZ, dustR, dustG, dustB, currRange, centRange );
-                                    else if ( isRingPix )
-                                        result = env->projectDust( drawX[i], drawY[i], dustZ, dustR, dustG, dustB, currRange, ringRange );
-                                    else
-                                        result = env->projectDust( drawX[i], drawY[i], dustZ, dustR, dustG, dustB, currRange, maxRange );
-                                }
-                            } // End of having a dust sphere pixel
-                        } // End of having a drawable and visible pixel
-                        env->unlock();
-                    } // End of projection loop
-                } // End of being inside the object
-            } // End of having at least one drawable pixel
+            sUnitPixel pix;
+
+            // Now do only continue if at least one of the 4 pixels is drawable and the offset is part of the unit:
+            if ( ( doDraw[0] || doDraw[1] || doDraw[2] || doDraw[3] )
+                    && getPixel( env, shape, static_cast<int32_t>( xOff ), static_cast<int32_t>( yOff ), pix ) ) {
+                bool hasMass = pix.isMassPix || ( pix.isRingPix && shape.ringHasMass );
+                bool hasDust = pix.isDustPix || pix.isRemnPix || ( pix.isRingPix && !shape.ringHasMass );
+
+                for ( int32_t i = 0; i < 4; ++i ) {
+                    if ( doDraw[i] ) {
+                        // Project mass pixel first, the zMassMap needs no lock.
+                        if ( hasMass && isVisible( env, drawX[i], drawY[i], pix.massZ ) ) {
+                            uint8_t currR = pix.r;
+                            uint8_t currG = pix.g;
+                            uint8_t currB = pix.b;
+                            addSimplexOffset( env, drawX[i], drawY[i], pix.massZ, pix.isMassPix, pix.isRingPix, currR, currG, currB );
+                            env->projectMass( drawX[i], drawY[i], pix.massZ, currR, currG, currB, !clip );
+                        } // End of having a mass pixel
+
+                        // Now project the dust pixel if there is one
+                        if ( !clip ) env->lock();
+                        if ( hasDust && isVisible( env, drawX[i], drawY[i], pix.dustZ ) ) {
+                            // Note: Each mirrored pixel gets its own offset, so the Z must not be shared.
+                            double currRange = pix.range;
+                            double currZ     = pix.dustZ;
+                            addSimplexOffset( env, drawX[i], drawY[i], currZ, pix.isDustPix || pix.isRemnPix, pix.isRingPix, currRange );
+
+                            // If the range is shortened, currZ is moved a bit away. We therefore have to check again:
+                            if ( ( currRange > Min_Dust_Range ) && isFront( env, drawX[i], drawY[i], currZ ) )
+                                result = env->projectDust( drawX[i], drawY[i], currZ, shape.dustR, shape.dustG, shape.dustB,
+                                                           currRange, pix.maxRange );
+                        } // End of having a dust sphere pixel
+                        if ( !clip ) env->unlock();
+                    } // End of having a drawable and visible pixel
+                } // End of projection loop
+            } // End of having at least one drawable pixel inside the object
         } // End of y offset loop
     } // End of x offset loop
 
@@ -762,6 +1208,7 @@ ifstream& CMatter::load ( std::ifstream& is ) {
         using ::pwx::StreamHelpers::readNextValue;
 
         is >> xVers; // After this we have semicolon separated values
+        if ( success && ( xVers > 2 ) ) { success = readNextValue ( id, is, ';', false, false ); }
         if ( success ) { success = readNextValue ( mass,      is, ';', false, false ); }
         if ( success ) { success = readNextValue ( radius,    is, ';', false, false ); }
         if ( success ) { success = readNextValue ( posX,      is, ';', false, false ); }
@@ -787,7 +1234,7 @@ ifstream& CMatter::load ( std::ifstream& is ) {
 /// @brief save a unit to an ostream
 ostream& CMatter::save ( std::ostream& os ) const {
     if ( os.good() ) {
-        os << 2 << ";";
+        os << 3 << ";" << id << ";";
         os << mass       << ";" << radius << ";";
         os << posX       << ";" << posY       << ";" << posZ << ";";
         os << impX       << ";" << impY       << ";" << impZ << ";";
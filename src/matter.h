@@ -7,6 +7,57 @@
 // Here we need it, sfmlui.cpp::initSFML() will create it:
 #include "colormap.h"
 
+// Merges are recorded there, if --mergelog is used:
+class CCollLog;
+
+// The tile renderer hands out prepared projections and the tiles to draw them into:
+struct sProjInfo;
+struct sTileRect;
+
+/// @brief Units with a smaller dust radius than this only cover their center and its eight neighbours, see CMatter::projectSprite()
+const double Sprite_Max_Rad = 2.0;
+
+
+/// @brief The look of a unit for one frame, everything projecting a pixel of it needs, see CMatter::prepShape()
+struct sUnitShape {
+    int32_t x;            //!< Drawing position X value
+    int32_t y;            //!< Drawing position Y value
+    double  z;            //!< Position on the virtual Z-Axis
+    double  vR;           //!< View radius
+    double  dR;           //!< Dust radius, widened for detonation rings to cover the ring
+    double  stop;         //!< Offsets from the center up to this one (exclusive) are calculated
+    double  maxRange;     //!< Maximum range of the dust sphere
+    double  calcRange;    //!< Range of the halo masses with a view radius of up to 0.5 have in the center
+    double  calcMaxRange; //!< Maximum range of that halo
+    double  centRange;    //!< Detonation rings only: maximum range of the remnant of the consumed mass
+    double  ringCent;     //!< Detonation rings only: distance of the ring center to the unit center
+    double  ringRange;    //!< Detonation rings only: maximum range of a ring fading to dust
+    double  ringStop;     //!< Detonation rings only: distance where the ring ends
+    bool    ringHasMass;  //!< Detonation rings only: false once the ring fades to dust
+    uint8_t r;            //!< Red part of the mass color
+    uint8_t g;            //!< Green part of the mass color
+    uint8_t b;            //!< Blue part of the mass color
+    uint8_t dustR;        //!< Red part of the dust color
+    uint8_t dustG;        //!< Green part of the dust color
+    uint8_t dustB;        //!< Blue part of the dust color
+};
+
+
+/// @brief What a unit shows at one offset from its center, see CMatter::getPixel()
+struct sUnitPixel {
+    bool    isDustPix; //!< The pixel is part of the dust sphere
+    bool    isMassPix; //!< The pixel is part of the mass
+    bool    isRemnPix; //!< The pixel is part of the remnant in the center of a detonation ring
+    bool    isRingPix; //!< The pixel is part of a detonation ring
+    double  dustZ;     //!< Near end of the dust sphere part
+    double  massZ;     //!< Position of the mass pixel
+    double  range;     //!< Range of the dust sphere part
+    double  maxRange;  //!< Maximum range of the dust sphere the part belongs to
+    uint8_t r;         //!< Red part of the mass pixel, darkened towards the edge
+    uint8_t g;         //!< Green part of the mass pixel, darkened towards the edge
+    uint8_t b;         //!< Blue part of the mass pixel, darkened towards the edge
+};
+
 
 /** @class CMatter
   * @brief Simple class to hold matter data and not so simple move it
@@ -23,6 +74,8 @@ class CMatter : public pwx::Lockable {
     double radius;           //!< Radius in meters
     double ringRadius;       //!< Radius factor of the ring when exploding, based on radius
     double ringMass;         //!< Mass of the explosion ring in kg
+    double collGap;          //!< Lower bound of the gap to the nearest unit in positional coordinates, see thrdCheck()
+    uint32_t id;             //!< Unique number of the unit, set by initSFML() unless loaded, used by the merge log
 
     // Access methods within this class and between objects
 
@@ -49,6 +102,12 @@ class CMatter : public pwx::Lockable {
         return ( env && ( x >= 0 ) && ( x < env->scrWidth ) && ( y >= 0 ) && ( y < env->scrHeight ) );
     }
 
+    /// @brief return true if a unit with the view radius @a vR and the dust radius @a dR is projected by projectSprite()
+    bool isSprite( double vR, double dR ) const PWX_WARNUNUSED {
+        // Neither rings nor masses reaching over the center pixel qualify
+        return !( 1.0 > mass ) && ( vR < 1.0 ) && !( dR > Sprite_Max_Rad );
+    }
+
     /// @brief Sets the radius according to the unified density
     void setRadius( ENVIRONMENT* env ) {
         assert ( env && "ERROR: setRadius called without valid env!" );
@@ -72,11 +131,14 @@ class CMatter : public pwx::Lockable {
     }
 
     /* --- outline methods --- */
-    // Note: Although isFront and isVisible are one-liners, isFront needs the full sMassPixel struct and isVisible needs isFront
+    // Note: Although isFront and isVisible are one-liners, isFront needs the full sMassWord struct and isVisible needs isFront
     inline bool    isFront    ( ENVIRONMENT* env, int32_t x, int32_t y, double z ) PWX_WARNUNUSED;
+    inline bool    isInClip   ( const sTileRect* clip, int32_t x, int32_t y ) PWX_WARNUNUSED;
     inline bool    isVisible  ( ENVIRONMENT* env, int32_t x, int32_t y, double z ) PWX_WARNUNUSED;
-    inline int32_t projectUnit( ENVIRONMENT* env, int32_t x, int32_t y, double z,
-                                    double vR, double dR, double dMR, uint8_t r, uint8_t g, uint8_t b ) PWX_WARNUNUSED;
+    inline bool    getPixel   ( ENVIRONMENT* env, const sUnitShape& shape, int32_t xIdx, int32_t yIdx,
+                                    sUnitPixel& pix ) const PWX_WARNUNUSED;
+    inline int32_t projectSprite( ENVIRONMENT* env, const sUnitShape& shape, const sTileRect* clip ) PWX_WARNUNUSED;
+    inline int32_t projectUnit( ENVIRONMENT* env, const sProjInfo& info, const sTileRect* clip = NULL ) PWX_WARNUNUSED;
 
 
   public:
@@ -95,7 +157,7 @@ class CMatter : public pwx::Lockable {
         impX( 0.0 ), impY( 0.0 ), impZ( 0.0 ),
         accX( 0.0 ), accY( 0.0 ), accZ( 0.0 ),
         movX( 0.0 ), movY( 0.0 ), movZ( 0.0 ),
-        distance( 0.0 ), mass( 1.0 ), radius( 0.0 ), ringRadius( 0.0 ), ringMass( 0.0 ) {
+        distance( 0.0 ), mass( 1.0 ), radius( 0.0 ), ringRadius( 0.0 ), ringMass( 0.0 ), collGap( 0.0 ), id( 0 ) {
         assert ( env && "ERROR: CMatter ctor called without valid env!" );
         assert ( env && env->universe && "ERROR: CMatter ctor called without valid universe!" );
 
@@ -131,17 +193,52 @@ class CMatter : public pwx::Lockable {
         impX( 0.0 ), impY( 0.0 ), impZ( 0.0 ),
         accX( 0.0 ), accY( 0.0 ), accZ( 0.0 ),
         movX( 0.0 ), movY( 0.0 ), movZ( 0.0 ),
-        distance( 0.0 ), mass( 0.0 ), radius( 0.0 ), ringRadius( 0.0 ), ringMass( 0.0 )
+        distance( 0.0 ), mass( 0.0 ), radius( 0.0 ), ringRadius( 0.0 ), ringMass( 0.0 ), collGap( 0.0 ), id( 0 )
     { }
 
     /// @brief default dtor, does nothing.
     ~CMatter() {}
 
-    /// @brief return true if this unit is destroyed
+    /// @brief copy all values but the lock of @a src, used for the units the renderer draws with --pipeline
+    void   copyFrom( const CMatter& src ) {
+        posX       = src.posX;       posY = src.posY; posZ = src.posZ;
+        impX       = src.impX;       impY = src.impY; impZ = src.impZ;
+        accX       = src.accX;       accY = src.accY; accZ = src.accZ;
+        movX       = src.movX;       movY = src.movY; movZ = src.movZ;
+        distance   = src.distance;
+        mass       = src.mass;
+        radius     = src.radius;
+        ringRadius = src.ringRadius;
+        ringMass   = src.ringMass;
+        collGap    = src.collGap;
+        id         = src.id;
+    }
+
+    /** @brief return true if this unit is destroyed
+      *
+      * A destroyed unit stays in the container until its ring is gone(), which
+      * takes several cycles. The collision structures that keep units across
+      * cycles have to drop it before the unit itself is deleted.
+    **/
     bool   destroyed() PWX_WARNUNUSED {
         return 1.0 > mass ;
     }
 
+    /// @brief return the lower bound of the gap to the nearest unit, see thrdCheck()
+    double getCollGap() const { return collGap; }
+
+    /// @brief return the unique number of this unit, 0 if none is set, yet
+    uint32_t getId() const { return id; }
+
+    /// @brief return the absolute movement in m/s
+    double getMovement() const { return ::pwx::absDistance( movX, movY, movZ, 0., 0., 0. ); }
+
+    /// @brief return the posX value, this is needed to sort the unit into a collision broad-phase
+    double getPosX() const { return posX; }
+
+    /// @brief return the posY value, this is needed to sort the unit into a collision broad-phase
+    double getPosY() const { return posY; }
+
     /// @brief return the posZ value, this is needed to determine minZ while loading if dynamic camera is used
     double getPosZ() const { return posZ; }
 
@@ -165,6 +262,12 @@ class CMatter : public pwx::Lockable {
 
 
     // Access methods:
+    /// @brief set the lower bound of the gap to the nearest unit, see thrdCheck()
+    void setCollGap( double gap ) { collGap = gap; }
+
+    /// @brief set the unique number of this unit
+    void setId( uint32_t newId ) { id = newId; }
+
     /// @brief reset the impulse values *before* calculating new gravitation
     void resetImpulse() {
         impX = 0.;
@@ -182,12 +285,31 @@ class CMatter : public pwx::Lockable {
      * 6.: Project it to the projection plane
      *
      * - Position 4 is done from the outside, the container does it.
+     * - Position 5 is split: isColliding() finds the pairs, the static
+     *   applyCollision() merges whole groups of them.
+     * - Position 6 is split: prepView() determines where the unit is drawn,
+     *   and prepProject() skips it if it is hidden or determines its color.
+     *   For the tile renderer projectTile() draws the part inside one tile,
+     *   and advanceRing() lets a detonation ring grow once all tiles are done.
+     *   project() does all but prepView() in one go. The ray caster keeps
+     *   the look prepShape() determines and asks tracePixel() for single pixels.
     */
+    void    advanceRing      ( ENVIRONMENT* env );
     void    applyGravitation ( ENVIRONMENT* env, CMatter* rhs );
     void    applyImpulses    ( ENVIRONMENT* env );
     void    applyMovement    ( ENVIRONMENT* env );
-    void    applyCollision   ( ENVIRONMENT* env, CMatter* rhs );
-    int32_t project          ( ENVIRONMENT* env ) PWX_WARNUNUSED;
+    double  getGap           ( ENVIRONMENT* env, CMatter* rhs ) const PWX_WARNUNUSED;
+    bool    isColliding      ( ENVIRONMENT* env, CMatter* rhs, double* toi = NULL ) PWX_WARNUNUSED;
+    bool    prepView         ( ENVIRONMENT* env, sProjInfo& info );
+    bool    prepProject      ( ENVIRONMENT* env, sProjInfo& info );
+    int32_t project          ( ENVIRONMENT* env, sProjInfo& info ) PWX_WARNUNUSED;
+    int32_t projectTile      ( ENVIRONMENT* env, const sProjInfo& info, const sTileRect& clip ) PWX_WARNUNUSED;
+    void    prepShape        ( ENVIRONMENT* env, const sProjInfo& info, sUnitShape& shape ) const;
+    bool    tracePixel       ( ENVIRONMENT* env, const sUnitShape& shape, int32_t x, int32_t y, double& massZ,
+                               uint8_t& r, uint8_t& g, uint8_t& b, std::vector<sDustFrag>& frags ) PWX_WARNUNUSED;
+
+    static int32_t applyCollision( ENVIRONMENT* env, CMatter** units, const int32_t* group, int32_t count,
+                                   CCollLog* log = NULL, int32_t tNum = 0, const double* impact = NULL );
 
     /// @brief return true if this distance to the center is larger than the one of rhs
     bool operator>( CMatter& rhs ) {
@@ -0,0 +1,240 @@
+#include <algorithm>
+
+#include "raybvh.h"
+#include "tilebins.h"
+#include "dustpixel.h"
+
+
+/// @brief spread the lower 16 bits of @a value so that there is one zero bit between each of them
+static uint32_t spreadBits( uint32_t value ) {
+    value &= 0x0000ffff;
+    value = ( value | ( value << 8 ) ) & 0x00ff00ff;
+    value = ( value | ( value << 4 ) ) & 0x0f0f0f0f;
+    value = ( value | ( value << 2 ) ) & 0x33333333;
+    value = ( value | ( value << 1 ) ) & 0x55555555;
+    return value;
+}
+
+
+/// @brief return true if the pixel @a x / @a y lies inside the rectangle @a lo / @a hi
+static bool covers( const int32_t* lo, const int32_t* hi, int32_t x, int32_t y ) {
+    return ( x >= lo[0] ) && ( x <= hi[0] ) && ( y >= lo[1] ) && ( y <= hi[1] );
+}
+
+
+/** @brief build the hierarchy anew from the prepared projections of all units
+  *
+  * Only units prepProject() has left visible are taken. The nearest position
+  * of a unit is its dust sphere, moved nearer by a tenth of its range at most
+  * by the simplex offset, or the center of a halo.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] info Array of the prepared projections of all units
+  * @param[in] count Number of entries in @a info
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the tables could not be allocated
+**/
+int32_t CRayBVH::build( ENVIRONMENT* env, const sProjInfo* info, int32_t count ) {
+    assert( env && "ERROR: CRayBVH::build() called without valid env!" );
+
+    std::vector<std::pair<uint32_t, int32_t> > order; // Morton code and item index
+    std::vector<sRayItem> sorted;
+    std::vector<uint32_t> codes;
+
+    try {
+        // 1.: Gather all units that are drawn, with their footprints cut at the plane
+        items.clear();
+        nodes.clear();
+        for ( int32_t i = 0; i < count; ++i ) {
+            const sProjInfo& curr = info[i];
+            if ( !curr.isVisible )
+                continue;
+
+            sRayItem item;
+            item.lo[0] = std::max( curr.x - curr.reach, 0 );
+            item.lo[1] = std::max( curr.y - curr.reach, 0 );
+            item.hi[0] = std::min( curr.x + curr.reach, env->scrWidth  - 1 );
+            item.hi[1] = std::min( curr.y + curr.reach, env->scrHeight - 1 );
+            if ( ( item.lo[0] > item.hi[0] ) || ( item.lo[1] > item.hi[1] ) )
+                continue;
+
+            item.nr   = i;
+            item.unit = curr.unit;
+            curr.unit->prepShape( env, curr, item.shape );
+            item.zNear = curr.z - ( 1.2 * std::max( item.shape.dR, curr.vR ) );
+            items.push_back( item );
+        }
+
+        int32_t itemCount = static_cast<int32_t>( items.size() );
+        order.resize( itemCount );
+        sorted.resize( itemCount );
+        codes.resize( itemCount );
+        nodes.reserve( itemCount ? ( 4 * itemCount / leafSize ) + 1 : 0 );
+
+        // 2.: Give every unit a 32 bit Morton code of the center of its footprint...
+        for ( int32_t i = 0; i < itemCount; ++i ) {
+            uint32_t cX = static_cast<uint32_t>( std::min( ( items[i].lo[0] + items[i].hi[0] ) / 2, 0xffff ) );
+            uint32_t cY = static_cast<uint32_t>( std::min( ( items[i].lo[1] + items[i].hi[1] ) / 2, 0xffff ) );
+            order[i].first  = spreadBits( cX ) | ( spreadBits( cY ) << 1 );
+            order[i].second = i;
+        }
+
+        // 3.: ...sort them along the curve...
+        std::sort( order.begin(), order.end() );
+        for ( int32_t i = 0; i < itemCount; ++i ) {
+            sorted[i] = items[order[i].second];
+            codes[i]  = order[i].first;
+        }
+        items.swap( sorted );
+
+        // 4.: ...and split them into nodes.
+        if ( itemCount )
+            buildNode( codes, 0, itemCount );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the ray casting hierarchy for " << count << " units! [";
+        cerr << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/** @brief build the node for the items @a first to @a first + @a count - 1
+  *
+  * The items must be sorted by their @a codes. They are split where the
+  * highest bit that differs between the first and the last code changes, or in
+  * the middle if all codes are equal. The footprint and the nearest position
+  * of the node are set once its children are built.
+**/
+void CRayBVH::buildNode( const std::vector<uint32_t>& codes, int32_t first, int32_t count ) {
+    int32_t idx = static_cast<int32_t>( nodes.size() );
+    sRayNode node;
+    node.lo[0] = items[first].lo[0];
+    node.lo[1] = items[first].lo[1];
+    node.hi[0] = items[first].hi[0];
+    node.hi[1] = items[first].hi[1];
+    node.zNear = items[first].zNear;
+    node.first = first;
+    node.count = count;
+    node.right = -1;
+
+    if ( count <= leafSize ) {
+        for ( int32_t i = first + 1; i < first + count; ++i ) {
+            node.lo[0] = std::min( node.lo[0], items[i].lo[0] );
+            node.lo[1] = std::min( node.lo[1], items[i].lo[1] );
+            node.hi[0] = std::max( node.hi[0], items[i].hi[0] );
+            node.hi[1] = std::max( node.hi[1], items[i].hi[1] );
+            node.zNear = std::min( node.zNear, items[i].zNear );
+        }
+        nodes.push_back( node );
+        return;
+    }
+    nodes.push_back( node );
+
+    uint32_t firstCode = codes[first];
+    uint32_t lastCode  = codes[first + count - 1];
+    int32_t  split     = count / 2;
+
+    if ( firstCode != lastCode ) {
+        int32_t bit = 0;
+        while ( ( firstCode ^ lastCode ) >> ( bit + 1 ) )
+            ++bit;
+        // All codes up to key share the prefix of the first code and have the differing bit unset
+        uint32_t key = ( ( firstCode >> bit ) << bit ) | ( ( 1U << bit ) - 1 );
+        split = static_cast<int32_t>( std::upper_bound( codes.begin() + first, codes.begin() + first + count, key )
+                                      - ( codes.begin() + first ) );
+    }
+
+    buildNode( codes, first, split );
+    int32_t right = static_cast<int32_t>( nodes.size() );
+    buildNode( codes, first + split, count - split );
+
+    const sRayNode& lhs = nodes[idx + 1];
+    const sRayNode& rhs = nodes[right];
+    sRayNode&       curr = nodes[idx];
+    curr.count = 0;
+    curr.right = right;
+    curr.lo[0] = std::min( lhs.lo[0], rhs.lo[0] );
+    curr.lo[1] = std::min( lhs.lo[1], rhs.lo[1] );
+    curr.hi[0] = std::max( lhs.hi[0], rhs.hi[0] );
+    curr.hi[1] = std::max( lhs.hi[1], rhs.hi[1] );
+    curr.zNear = std::min( lhs.zNear, rhs.zNear );
+}
+
+
+/** @brief determine the color of the pixel @a x / @a y
+  *
+  * The nearest mass pixel of all units wins, on equal positions the unit that
+  * comes first in the container, like it does with the tile renderer. All dust
+  * sphere parts in front of it are blended over it by blendDustFrags().
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] x X-Coordinate of the pixel
+  * @param[in] y Y-Coordinate of the pixel
+  * @param[out] r Receives the red part of the pixel
+  * @param[out] g Receives the green part of the pixel
+  * @param[out] b Receives the blue part of the pixel
+  * @param[in] frags Scratch space of the calling thread
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the dust sphere parts could not be stored
+**/
+int32_t CRayBVH::trace( ENVIRONMENT* env, int32_t x, int32_t y, uint8_t& r, uint8_t& g, uint8_t& b,
+                        std::vector<sDustFrag>& frags ) const {
+    int32_t stack[128]; // The tree is never deeper than 32 bit splits plus 32 middle splits
+    int32_t top    = 0;
+    int32_t massNr = -1;  // Number of the unit the nearest mass belongs to
+    double  massZ  = -1.; // Position of the nearest mass
+
+    r = 0;
+    g = 0;
+    b = 0;
+    frags.clear();
+    if ( nodes.empty() )
+        return EXIT_SUCCESS;
+
+    try {
+        stack[top++] = 0;
+        while ( top ) {
+            int32_t         idx  = stack[--top];
+            const sRayNode& node = nodes[idx];
+
+            // Nodes lying completely behind the nearest mass can not add anything
+            if ( !covers( node.lo, node.hi, x, y ) || ( ( massNr > -1 ) && ( node.zNear > massZ ) ) )
+                continue;
+
+            if ( node.right < 0 ) {
+                for ( int32_t i = node.first; i < node.first + node.count; ++i ) {
+                    const sRayItem& item = items[i];
+                    if ( !covers( item.lo, item.hi, x, y ) || ( ( massNr > -1 ) && ( item.zNear > massZ ) ) )
+                        continue;
+
+                    double  currZ = 0.;
+                    uint8_t currR = 0, currG = 0, currB = 0;
+                    if ( item.unit->tracePixel( env, item.shape, x, y, currZ, currR, currG, currB, frags )
+                            && ( ( massNr < 0 ) || ( currZ < massZ ) || ( ( currZ == massZ ) && ( item.nr < massNr ) ) ) ) {
+                        massNr = item.nr;
+                        massZ  = currZ;
+                        r      = currR;
+                        g      = currG;
+                        b      = currB;
+                    }
+                }
+            } else {
+                // The nearer child is walked down first, so the nearest mass is found early
+                int32_t lhs = idx + 1;
+                int32_t rhs = node.right;
+                if ( nodes[rhs].zNear < nodes[lhs].zNear )
+                    std::swap( lhs, rhs );
+                stack[top++] = rhs;
+                stack[top++] = lhs;
+            }
+        }
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate dust fragments! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    env->blendDustFrags( massZ, r, g, b, frags );
+
+    return EXIT_SUCCESS;
+}
+
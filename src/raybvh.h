@@ -0,0 +1,88 @@
+#pragma once
+#ifndef PWX_GRAVMAT_RAYBVH_H_INCLUDED
+#define PWX_GRAVMAT_RAYBVH_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+#include "matter.h"
+
+// The units are taken from their prepared projections:
+struct sProjInfo;
+
+
+/// @brief One unit in the hierarchy together with its footprint and its look
+struct sRayItem {
+    int32_t    lo[2]; //!< Upper left pixel of the footprint, cut at the plane
+    int32_t    hi[2]; //!< Lower right pixel of the footprint, cut at the plane
+    double     zNear; //!< Nearest position any pixel of the unit can have
+    int32_t    nr;    //!< Number of the unit in the prepared projections
+    CMatter*   unit;  //!< The unit this footprint belongs to
+    sUnitShape shape; //!< The look of the unit, see CMatter::prepShape()
+};
+
+
+/// @brief One node of the hierarchy, the left child always directly follows its parent
+struct sRayNode {
+    int32_t lo[2]; //!< Upper left pixel of the footprints below
+    int32_t hi[2]; //!< Lower right pixel of the footprints below
+    double  zNear; //!< Nearest position any pixel of the units below can have
+    int32_t first; //!< Leaves only: First item of the leaf
+    int32_t count; //!< Leaves only: Number of items of the leaf
+    int32_t right; //!< Index of the right child, -1 for leaves
+};
+
+
+/** @class CRayBVH
+  * @brief Bounding volume hierarchy over the footprints of the units, used by the ray caster
+  *
+  * The units are projected onto the plane before anything is drawn, so a ray
+  * through a pixel only meets the units whose footprint (the drawing position
+  * plus/minus the reach) covers the pixel. The footprints are ordered along a
+  * Morton curve of their centers and split at the highest differing bit of
+  * their codes (LBVH), like CCollBVH does with the collision boxes. Every node
+  * knows the nearest position anything below it can be drawn at.
+  *
+  * trace() walks down the nodes covering the pixel, the nearer child first.
+  * Once a mass is found, every node that lies completely behind it is left
+  * out, which ends the ray at the first opaque mass in most pixels. Nothing is
+  * written but the result, and the simplex offsets of the units are sampled
+  * without a lock (see simplex3D()), so any number of threads can trace at once.
+  *
+  * The hierarchy is built anew every frame. It also keeps the look of every
+  * unit, so detonation rings can grow as soon as it is built.
+**/
+class CRayBVH {
+    std::vector<sRayItem> items; //!< Units in Morton order, grouped by leaf
+    std::vector<sRayNode> nodes; //!< The hierarchy in pre-order, nodes[0] is the root
+
+    static const int32_t  leafSize = 4; //!< Maximum number of units in a leaf
+
+    // Build the node for the items first to first + count - 1, which are sorted by their codes:
+    void    buildNode( const std::vector<uint32_t>& codes, int32_t first, int32_t count );
+
+  public:
+    /// @brief default ctor, the hierarchy is built by build()
+    explicit CRayBVH() { }
+
+    /// @brief default dtor, does nothing.
+    ~CRayBVH() { }
+
+    // Build the hierarchy anew from the prepared projections of all units:
+    int32_t build( ENVIRONMENT* env, const sProjInfo* info, int32_t count ) PWX_WARNUNUSED;
+
+    /// @brief return the number of units in the hierarchy
+    int32_t size() const { return static_cast<int32_t>( items.size() ); }
+
+    // Determine the color of the pixel x/y:
+    int32_t trace( ENVIRONMENT* env, int32_t x, int32_t y, uint8_t& r, uint8_t& g, uint8_t& b,
+                   std::vector<sDustFrag>& frags ) const PWX_WARNUNUSED;
+
+  private:
+    /* --- no copying! --- */
+    CRayBVH( CRayBVH& );
+    CRayBVH& operator=( CRayBVH& );
+};
+
+#endif // PWX_GRAVMAT_RAYBVH_H_INCLUDED
+
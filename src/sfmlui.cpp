@@ -1,7 +1,25 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdarg>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
 
 #include "sfmlui.h"
 #include "matter.h"
+#include "collbvh.h"
+#include "collgraph.h"
+#include "collgrid.h"
+#include "colllog.h"
+#include "collsap.h"
+#include "dustarena.h"
+#include "dustblend.h"
+#include "framewriter.h"
+#include "hizmap.h"
+#include "lodmap.h"
+#include "raybvh.h"
+#include "simplex.h"
+#include "tilebins.h"
 
 // Here the real pixel info headers have to be included
 #include "dustpixel.h" // It will pull masspixel.h in
@@ -25,6 +43,248 @@ typedef pwx::TDoubleRing<CMatter> matCont_t;
 // Global pointer to the matter container:
 matCont_t* mCont;
 
+// Flat copy of the container (or sweep) order, renewed by prepColl() for the collision check:
+std::vector<CMatter*> mSnap;
+
+// Prepared projections of all units in container order, renewed by projUnits():
+std::vector<sProjInfo> mProj;
+
+// Copies of the units the renderer draws with --pipeline, renewed by startRender():
+CMatter* mCopy     = NULL;
+int32_t  mCopyCap  = 0; // Number of units mCopy has room for
+int32_t  mCopySize = 0; // Number of units copied into mCopy
+
+// The thread leading the renderer group with --pipeline, see thrdRend():
+static sf::Thread*          rendThread = NULL;
+static std::atomic<bool>    rendering( false );
+static std::atomic<int32_t> rendResult( EXIT_SUCCESS );
+static int64_t              rendSecond = 0; // The simulated second the copies show
+
+
+// Set by SIGINT and SIGTERM with --headless, there is no window to be closed:
+static volatile sig_atomic_t stopSignal = 0;
+
+
+/// @brief remember that the program is to be ended, doEvents() tells the workLoop
+static void onStopSignal( int ) {
+    stopSignal = 1;
+}
+
+
+/** @brief write the stats line and the current message once per second with --headless
+  *
+  * Without a status file both go to stderr. The status file is written beside
+  * and then renamed, so anyone polling it never reads half a file.
+**/
+static void writeStatus( ENVIRONMENT* env ) {
+    if ( env->statusFile.size() ) {
+        std::string   tmpName = env->statusFile + ".tmp";
+        std::ofstream status( tmpName.c_str(), std::ios_base::out | std::ios_base::trunc );
+        if ( status.is_open() ) {
+            status << env->statMsg << "\n" << env->msg << endl;
+            status.close();
+            if ( !status.fail() && !std::rename( tmpName.c_str(), env->statusFile.c_str() ) )
+                return;
+        }
+        // If the file can not be written, the progress must not get lost:
+    }
+    cerr << env->statMsg << " | " << env->msg << endl;
+}
+
+
+/** @brief save the current picture as @a picName, or hand it over to the writers
+  *
+  * If the writers can not take the picture, because the queue is full, this
+  * waits for them while showing the queue and handling events.
+  *
+  * The writers copy the picture right out of env->frameBuf. Without a window
+  * the image only gets the pixels if it has to be saved here.
+  *
+  * @a second is the simulated second the picture shows, with --pipeline the
+  * physics is already ahead of it.
+**/
+static void savePicture( ENVIRONMENT* env, const char* picName, int64_t second ) {
+    // Without a reader there is no use in going on
+    if ( env->frameWriter && env->frameWriter->hasStreamError() ) {
+        cerr << "ERROR: The stream \"" << env->streamPath << "\" can not be written any more, stopping." << endl;
+        env->doWork = false;
+        return;
+    }
+
+    if ( env->frameWriter ) {
+        while ( !env->frameWriter->push( env->frameBuf.data(), env->scrWidth, env->scrHeight,
+                                         picName, env->picNum, second ) ) {
+            showMsg( env, "waiting for writers (%d queued) ...", env->frameWriter->getDepth() );
+            doEvents( env );
+            pwx_sleep( 5 );
+        }
+    } else {
+        showMsg( env, "saving picture %s ...", picName );
+        if ( env->doHeadless )
+            env->image.LoadFromPixels( env->scrWidth, env->scrHeight, env->frameBuf.data() );
+        env->image.SaveToFile( std::string( picName ) );
+    }
+}
+
+
+/** @brief update the screen, unless there is none, and save the picture
+  *
+  * These are the steps 10 and 11 of the workLoop, with --pipeline they are
+  * done once the renderer is finished with the picture.
+  *
+  * @a second is the simulated second the picture shows, see savePicture().
+**/
+static void putPicture( ENVIRONMENT* env, char* picName, int64_t second ) {
+    /// === Step 10 ===
+    /// Update screen, unless there is none
+    if ( env->doWork && !env->doHeadless ) {
+        // The whole picture goes into the image in one go
+        env->image.LoadFromPixels( env->scrWidth, env->scrHeight, env->frameBuf.data() );
+        env->screen->Clear();
+        env->screen->Draw( sf::Sprite( env->image ) );
+        env->screen->Display();
+        // Process events to get out early if wanted:
+        doEvents( env );
+    }
+
+    /// === Step 11 ===
+    /// Save the image
+    if ( env->doWork ) {
+        // save the image
+        pwx_snprintf( picName, 255, env->outFileFmt.c_str(), ++env->picNum );
+        // Only show message if doWork is true, or the screen might have gone away!
+        savePicture( env, picName, second );
+    }
+}
+
+
+/** @brief wait for the threads of @a group to finish
+  *
+  * Group 0 shows its progress with waitThrd(). The renderer group of
+  * --pipeline runs beside the workLoop, which does all the drawing and the
+  * event handling, so it only sleeps until its threads are done.
+**/
+static void waitGroup( ENVIRONMENT* env, const char* msg, int32_t maxNr, int32_t group ) {
+    if ( group ) {
+        while ( running( env, NULL, group ) )
+            pwx_sleep( 1 );
+    } else
+        waitThrd( env, msg, maxNr );
+}
+
+
+/** @brief trace all pixels from camera to source with the threads of @a group
+  *
+  * This is step 9 of the workLoop, the units must have been projected by
+  * projUnits() with the same @a group.
+**/
+static void traceUnits( ENVIRONMENT* env, int32_t group ) {
+    // The ray caster traces whole rows through its hierarchy, the others read the zMaps
+    if ( ERM_RAYCAST == env->renderMode ) {
+        env->startThreads( &thrdRay, group );
+        waitGroup( env, "Tracing...", env->scrHeight, group );
+    } else {
+        env->startThreads( &thrdDraw, group );
+        waitGroup( env, "Tracing...", 0, group );
+    }
+    env->clearThreads( group );
+    // No chain references the dust arena any more, but what did not fit is reported:
+    env->statDustDrop = env->dustArena->getDropped();
+    env->dustArena->reset();
+}
+
+
+/** @brief wait for the renderer of --pipeline, then show and save its picture
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[out] picName Receives the name of the saved picture
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the renderer failed
+**/
+static int32_t finishRender( ENVIRONMENT* env, char* picName ) {
+    if ( !rendThread )
+        return EXIT_SUCCESS;
+
+    // 1.: Wait for the renderer, its threads end early once doWork is false
+    while ( rendering.load( std::memory_order_acquire ) ) {
+        int32_t progress = 0;
+        running( env, &progress, 1 );
+        showMsg( env, "waiting for renderer (%d done) ...", progress );
+        doEvents( env );
+        pwx_sleep( 5 );
+    }
+    rendThread->Wait();
+    delete rendThread;
+    rendThread = NULL;
+
+    // 2.: Show and save the picture
+    int32_t result = rendResult.load( std::memory_order_acquire );
+    if ( EXIT_SUCCESS == result )
+        putPicture( env, picName, rendSecond );
+
+    return result;
+}
+
+
+/** @brief copy all units that are not gone and let the renderer draw them
+  *
+  * With --pipeline the renderer draws the copies with the threads of group 1,
+  * while the workLoop moves the units on. The rings of the units grow right
+  * away, the copies keep the size they are drawn with. finishRender() must
+  * have been called before, so there is no renderer running.
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the copies or the thread could not be allocated
+**/
+static int32_t startRender( ENVIRONMENT* env ) {
+    matContInt iCont( mCont );
+    int32_t    maxUnit = iCont.size();
+
+    assert( !rendThread && "ERROR: startRender() called while the renderer is running!" );
+
+    // 1.: Make room for all units
+    if ( maxUnit > mCopyCap ) {
+        try {
+            CMatter* copies = new CMatter[maxUnit];
+            delete [] mCopy;
+            mCopy    = copies;
+            mCopyCap = maxUnit;
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR: unable to allocate " << maxUnit << " copies of the units! [" << e.what() << "]" << endl;
+            env->doWork = false;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // 2.: Copy the units, those that are gone would not be drawn anyway
+    mCopySize = 0;
+    for ( int32_t lNr = 0; env->doWork && ( lNr < maxUnit ); ++lNr ) {
+        CMatter* unit = iCont[lNr];
+        if ( !unit->gone( env ) ) {
+            mCopy[mCopySize++].copyFrom( *unit );
+            unit->advanceRing( env );
+        }
+    }
+
+    // 3.: Move the camera, the physics might change minZ while the renderer runs
+    env->setDynamicZ();
+    rendSecond = env->secondsDone;
+
+    // 4.: Start the renderer
+    try {
+        rendering.store( true, std::memory_order_relaxed );
+        rendResult.store( EXIT_SUCCESS, std::memory_order_relaxed );
+        rendThread = new sf::Thread( &thrdRend, env );
+        rendThread->Launch();
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the renderer thread! [" << e.what() << "]" << endl;
+        rendering.store( false, std::memory_order_relaxed );
+        env->doWork = false;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 
 /// @brief Do not forget to call before program ends!
 void cleanup() {
@@ -32,11 +292,24 @@ void cleanup() {
         delete mCont;
         mCont = nullptr;
     }
+    if ( mCopy ) {
+        delete [] mCopy;
+        mCopy     = NULL;
+        mCopyCap  = 0;
+        mCopySize = 0;
+    }
 }
 
 void doEvents( ENVIRONMENT* env ) {
     sf::Event event;
 
+    // Without a window there are no events, only the signals to quit:
+    if ( env->doHeadless ) {
+        if ( stopSignal )
+            env->doWork = false;
+        return;
+    }
+
     while ( env->screen->GetEvent( event ) ) {
         /// 1.: Check whether to quit:
         if ( ( sf::Event::Closed == event.Type )
@@ -87,12 +360,9 @@ void doEvents( ENVIRONMENT* env ) {
         env->screen->Display();
 }
 
-/// @brief just a little wrapper so matter.cpp doesn't need an own instance of RNG
+/// @brief simplex offset for matter.cpp, called for every projected pixel by all threads, so RNG and its lock are not used
 double getSimOff( double x, double y, double z, double zoom ) {
-    RNG.lock();
-    double offset = RNG.simplex3D( x, y, z, zoom );
-    RNG.unlock();
-    return offset;
+    return simplex3D( x, y, z, zoom );
 }
 
 int32_t initSFML( ENVIRONMENT* env ) {
@@ -116,23 +386,29 @@ int32_t initSFML( ENVIRONMENT* env ) {
         cout << e.what() << "]" << endl;
     }
 
-    // Create Window:
-    string title = "Gravitation Matters V";
-    title += env->getVersion();
-    title += " (c) PrydeWorX 2007-2012 (";
-    title += pwx::StreamHelpers::to_string( env->numThreads );
-    title += " Threads)";
-    PWX_TRY( env->screen = new sf::RenderWindow( sf::VideoMode( env->scrWidth, env->scrHeight ), title ) )
-    catch ( std::bad_alloc& e ) {
-        result = EXIT_FAILURE;
-        cerr << "Unable to init SFML RenderWindow: \"" << e.what() << "\"" << endl;
-    }
+    // Create Window, or have the signals end the work if there is none:
+    if ( env->doHeadless ) {
+        std::signal( SIGINT,  onStopSignal );
+        std::signal( SIGTERM, onStopSignal );
+    } else {
+        string title = "Gravitation Matters V";
+        title += env->getVersion();
+        title += " (c) PrydeWorX 2007-2012 (";
+        title += pwx::StreamHelpers::to_string( env->numThreads );
+        title += " Threads)";
+        PWX_TRY( env->screen = new sf::RenderWindow( sf::VideoMode( env->scrWidth, env->scrHeight ), title ) )
+        catch ( std::bad_alloc& e ) {
+            result = EXIT_FAILURE;
+            cerr << "Unable to init SFML RenderWindow: \"" << e.what() << "\"" << endl;
+        }
 
-    // Set Icon:
-    env->screen->SetIcon( gravmat_icon.width, gravmat_icon.height, gravmat_icon.pixel_data );
+        // Set Icon:
+        if ( EXIT_SUCCESS == result )
+            env->screen->SetIcon( gravmat_icon.width, gravmat_icon.height, gravmat_icon.pixel_data );
+    }
 
-    // Load font:
-    if ( EXIT_SUCCESS == result ) {
+    // Load font, it is only needed for the window:
+    if ( ( EXIT_SUCCESS == result ) && !env->doHeadless ) {
         std::string fontpath = FONT_PATH;
         fontpath += FONT_SEP;
         fontpath += FONT_NAME;
@@ -168,9 +444,100 @@ int32_t initSFML( ENVIRONMENT* env ) {
         }
     }
 
+    // Initialize the merge graph and the collision broad-phase
+    if ( EXIT_SUCCESS == result ) {
+        try {
+            env->collGraph = new CCollGraph();
+            if ( ECM_GRID == env->collMode )
+                env->collGrid = new CCollGrid();
+            else if ( ECM_SAP == env->collMode )
+                env->collSap  = new CCollSAP();
+            else if ( ECM_BVH == env->collMode )
+                env->collBvh  = new CCollBVH();
+            if ( env->mergeLog.size() )
+                env->collLog  = new CCollLog();
+        } catch ( std::bad_alloc& e ) {
+            cerr << "Error initializing the collision broad-phase : " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    // The tile renderer needs its bins
+    if ( ( EXIT_SUCCESS == result ) && ( ERM_TILES == env->renderMode ) ) {
+        try {
+            env->tileBins = new CTileBins();
+        } catch ( std::bad_alloc& e ) {
+            cerr << "Error initializing the tile renderer : " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    // The ray caster needs its hierarchy
+    if ( ( EXIT_SUCCESS == result ) && ( ERM_RAYCAST == env->renderMode ) ) {
+        try {
+            env->rayBvh = new CRayBVH();
+        } catch ( std::bad_alloc& e ) {
+            cerr << "Error initializing the ray caster : " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    // Small units are only merged with --lod
+    if ( ( EXIT_SUCCESS == result ) && ( env->lodRad > 0. ) ) {
+        try {
+            env->lodMap = new CLodMap();
+        } catch ( std::bad_alloc& e ) {
+            cerr << "Error initializing the LOD merging : " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    // All renderers skip hidden units
+    if ( EXIT_SUCCESS == result ) {
+        try {
+            env->hiZMap = new CHiZMap();
+        } catch ( std::bad_alloc& e ) {
+            cerr << "Error initializing the occlusion map : " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    // Open the merge log
+    if ( ( EXIT_SUCCESS == result ) && env->collLog )
+        result = env->collLog->open( env->mergeLog.c_str() );
+
+    // Start the picture writers, they write the shared memory and the stream, too
+    if ( ( EXIT_SUCCESS == result ) && ( env->numWriters > 0 ) ) {
+        try {
+            env->frameWriter = new CFrameWriter();
+            if ( env->shmName.size() )
+                result = env->frameWriter->openShm( env->shmName.c_str(), env->shmSlots, env->scrWidth, env->scrHeight );
+            if ( ( EXIT_SUCCESS == result ) && env->streamPath.size() )
+                result = env->frameWriter->openStream( env->streamPath.c_str(), env->streamFmt, env->fps );
+            if ( EXIT_SUCCESS == result )
+                result = env->frameWriter->start( env->numWriters );
+        } catch ( std::bad_alloc& e ) {
+            cerr << "Error initializing the picture writers : " << e.what() << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
     // Set the image to our screen width and height:
     result = ( EXIT_SUCCESS == result ) && env->image.Create( env->scrWidth, env->scrHeight ) ? EXIT_SUCCESS : EXIT_FAILURE;
 
+    // The tracing threads draw into frameBuf, it starts as black as the image
+    if ( EXIT_SUCCESS == result ) {
+        try {
+            env->frameBuf.assign( static_cast<size_t>( env->scrWidth ) * env->scrHeight * 4, 0 );
+            for ( size_t i = 3; i < env->frameBuf.size(); i += 4 )
+                env->frameBuf[i] = 255;
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR: unable to allocate " << env->scrWidth << "x" << env->scrHeight << " pixels! [";
+            cerr << e.what() << "]" << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
     // Set SCT to use life calculation, we need maximum precision!
     if ( ( EXIT_SUCCESS == result ) && ( -1 != SCT.setPrecision( -1 ) ) ) {
         cerr << "ERROR: Setting SCT to life calculation failed! (Precision is " << SCT.getPrecision() << ")" << endl;
@@ -226,16 +593,31 @@ int32_t initSFML( ENVIRONMENT* env ) {
                 }
             } // End of initializing matter
 
+            // Give every unit that has none, yet, a unique number
+            if ( env->doWork ) {
+                matContInt iCont( mCont );
+                int32_t    maxUnit = iCont.size();
+                uint32_t   nextId  = 1;
+                for ( int32_t lNr = 0; lNr < maxUnit; ++lNr ) {
+                    if ( iCont[lNr]->getId() >= nextId )
+                        nextId = iCont[lNr]->getId() + 1;
+                }
+                for ( int32_t lNr = 0; lNr < maxUnit; ++lNr ) {
+                    if ( 0 == iCont[lNr]->getId() )
+                        iCont[lNr]->setId( nextId++ );
+                }
+            }
+
 
             // Finally draw all units and show that we are ready:
             if ( env->doWork ) {
                 env->setDynamicZ();
-                env->startThreads( &thrdProj );
-                waitThrd( env, "Projecting..." );
-                env->clearThreads();
-                env->startThreads( &thrdDraw );
-                waitThrd( env, "Tracing...   " );
-                env->clearThreads();
+                result = projUnits( env );
+                if ( EXIT_SUCCESS == result ) {
+                    traceUnits( env, 0 );
+                    if ( !env->doHeadless )
+                        env->image.LoadFromPixels( env->scrWidth, env->scrHeight, env->frameBuf.data() );
+                }
             }
         } catch( pwx::Exception& e ) {
             cerr << "pwx Exception: " << e.name() << " occurred at\n";
@@ -250,12 +632,192 @@ int32_t initSFML( ENVIRONMENT* env ) {
 }
 
 
-// Returns the number of running threads, and adds up their progress in @a progress
-int32_t running( ENVIRONMENT* env, int32_t* progress ) {
+// Check for collisions and merge all units that collided (Step 7)
+int32_t checkColl( ENVIRONMENT* env ) {
+    int32_t result = prepColl( env );
+
+    // 1.: Find all colliding pairs
+    if ( EXIT_SUCCESS == result ) {
+        env->startThreads( &thrdCheck );
+        waitThrd( env, "Collisions", static_cast<int32_t>( mSnap.size() ) );
+        env->clearThreads();
+    }
+
+    // 2.: Join them into groups
+    if ( env->doWork && ( EXIT_SUCCESS == result ) )
+        result = env->collGraph->build( static_cast<int32_t>( mSnap.size() ) );
+
+    // 3.: Merge every group into one unit
+    if ( env->doWork && ( EXIT_SUCCESS == result ) && env->collGraph->groups() ) {
+        env->startThreads( &thrdMerge );
+        waitThrd( env, "Merging", env->collGraph->groups() );
+        env->clearThreads();
+
+        // The writer takes it from here
+        if ( env->collLog )
+            env->collLog->flush();
+    }
+
+    if ( EXIT_FAILURE == result )
+        env->doWork = false;
+
+    return result;
+}
+
+
+// Reset the collision statistics and prepare the broad-phase and the merge graph for thrdCheck()
+int32_t prepColl( ENVIRONMENT* env ) {
+    int32_t    result  = env->collGraph->reset( env->numThreads );
+    if ( ( EXIT_SUCCESS == result ) && env->collLog )
+        result = env->collLog->prepare( env->numThreads );
+    matContInt iCont( mCont );
+    int32_t    maxUnit = iCont.size();
+
+    /* The gaps are only trusted if the last check merged nothing, because a merge
+     * lets the radius of the winner grow towards its neighbours. The skin is the
+     * range the gaps are measured over. Eight steps of the fastest unit let most
+     * units skip several checks without widening the broad-phases too much.
+     */
+    env->collGate      = 0 == env->statCollMerge;
+    env->collSkin      = 8. * env->universe->M2Pos * env->secPFmod * env->statMaxMove;
+
+    env->statCollCand  = 0;
+    env->statCollMerge = 0;
+    env->statCollSkip  = 0;
+    env->statCollSwept = 0;
+
+    if ( EXIT_SUCCESS == result ) {
+        try {
+            mSnap.resize( maxUnit );
+        } catch ( std::bad_alloc& e ) {
+            cerr << "ERROR: unable to allocate " << maxUnit << " unit pointers for the collision check! [";
+            cerr << e.what() << "]" << endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    if ( EXIT_SUCCESS == result ) {
+        for ( int32_t lNr = 0; lNr < maxUnit; ++lNr )
+            mSnap[lNr] = iCont[lNr];
+
+        if ( ECM_GRID == env->collMode )
+            result = env->collGrid->build( env, mSnap.data(), maxUnit );
+        else if ( ECM_SAP == env->collMode ) {
+            result = env->collSap->update( env, mSnap.data(), maxUnit );
+            // The sap hands out sweep positions, so the unit numbers have to follow the sweep
+            if ( EXIT_SUCCESS == result ) {
+                maxUnit = env->collSap->size();
+                mSnap.resize( maxUnit );
+                for ( int32_t lNr = 0; lNr < maxUnit; ++lNr )
+                    mSnap[lNr] = env->collSap->getUnit( lNr );
+            }
+        } else if ( ECM_BVH == env->collMode ) {
+            result = env->collBvh->update( env, mSnap.data(), maxUnit );
+            // The bvh numbers its units in leaf order, and so must mSnap
+            if ( EXIT_SUCCESS == result ) {
+                maxUnit = env->collBvh->size();
+                mSnap.resize( maxUnit );
+                for ( int32_t lNr = 0; lNr < maxUnit; ++lNr )
+                    mSnap[lNr] = env->collBvh->getUnit( lNr );
+            }
+        }
+    } // End of preparing the broad-phase
+
+    return result;
+}
+
+
+// Project all units onto the zMassMap and zDustMap (Step 8) with the threads of @a group
+int32_t projUnits( ENVIRONMENT* env, int32_t group ) {
+    int32_t    result  = EXIT_SUCCESS;
+    // The renderer group of --pipeline draws the copies startRender() has taken,
+    // it must not touch mCont, which the physics is changing meanwhile
+    int32_t    maxUnit = group ? mCopySize : matContInt( mCont ).size();
+
+    env->statHidden    = 0;
+    env->statLodMerged = 0;
+
+    try {
+        mProj.resize( maxUnit );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << maxUnit << " projections! [";
+        cerr << e.what() << "]" << endl;
+        result = EXIT_FAILURE;
+    }
+
+    // 1.: Determine where every unit is drawn
+    if ( env->doWork && ( EXIT_SUCCESS == result ) ) {
+        env->startThreads( &thrdView, group );
+        waitGroup( env, "Positioning...", 0, group );
+        env->clearThreads( group );
+    }
+
+    // 2.: Merge small units sharing a pixel if --lod is used
+    if ( env->doWork && ( EXIT_SUCCESS == result ) && env->lodMap ) {
+        result = env->lodMap->build( env, mProj.data(), maxUnit );
+        env->statLodMerged = env->lodMap->getMerged();
+    }
+
+    // 3.: Note how near the masses will be, so units hidden behind them can be skipped
+    if ( env->doWork && ( EXIT_SUCCESS == result ) )
+        result = env->hiZMap->build( env, mProj.data(), maxUnit );
+
+    // The old way: every thread projects whole units and locks every pixel
+    if ( ERM_UNITS == env->renderMode ) {
+        if ( env->doWork && ( EXIT_SUCCESS == result ) ) {
+            env->startThreads( &thrdProj, group );
+            waitGroup( env, "Projecting...", 0, group );
+            env->clearThreads( group );
+        }
+        if ( EXIT_FAILURE == result )
+            env->doWork = false;
+        return result;
+    }
+
+    // 4.: Color every unit that is not hidden
+    if ( env->doWork && ( EXIT_SUCCESS == result ) ) {
+        env->startThreads( &thrdBins, group );
+        waitGroup( env, "Binning...", 0, group );
+        env->clearThreads( group );
+    }
+
+    // 5.: Sort them into the tiles they touch, or into the hierarchy thrdRay() traces through
+    if ( env->doWork && ( EXIT_SUCCESS == result ) ) {
+        if ( ERM_RAYCAST == env->renderMode )
+            result = env->rayBvh->build( env, mProj.data(), maxUnit );
+        else
+            result = env->tileBins->build( env, mProj.data(), maxUnit );
+    }
+
+    // 6.: Project all tiles, the ray caster keeps the look of the units and draws them in step 9
+    if ( env->doWork && ( EXIT_SUCCESS == result ) && ( ERM_TILES == env->renderMode ) ) {
+        env->startThreads( &thrdTile, group );
+        waitGroup( env, "Projecting...", env->tileBins->size(), group );
+        env->clearThreads( group );
+    }
+
+    // 7.: The rings may only grow once every tile has drawn them, or their look is kept
+    //     For the copies of --pipeline startRender() has let them grow already.
+    if ( env->doWork && ( EXIT_SUCCESS == result ) && !group ) {
+        for ( int32_t lNr = 0; lNr < maxUnit; ++lNr ) {
+            if ( mProj[lNr].unit )
+                mProj[lNr].unit->advanceRing( env );
+        }
+    }
+
+    if ( EXIT_FAILURE == result )
+        env->doWork = false;
+
+    return result;
+}
+
+
+// Returns the number of running threads of @a group, and adds up their progress in @a progress
+int32_t running( ENVIRONMENT* env, int32_t* progress, int32_t group ) {
     int32_t running  = 0;
     if ( progress )
         *progress = 0;
-    for ( int32_t tNum = 0; tNum < env->numThreads; ++tNum ) {
+    for ( int32_t tNum = group * env->numThreads; tNum < ( group + 1 ) * env->numThreads; ++tNum ) {
         if ( env->threadRun[tNum] )
             ++running;
         if ( progress )
@@ -322,9 +884,6 @@ void setSleep( float pOld, float pCur, float pMax, int32_t* toSleep, int32_t* pa
 }
 
 void showMsg( ENVIRONMENT* env, const char* fmt, ... ) {
-    env->screen->Clear();
-    env->screen->Draw( sf::Sprite( env->image ) );
-
     float elapsed = env->statClock.GetElapsedTime();
     env->statTimeEla += elapsed;
 
@@ -338,6 +897,53 @@ void showMsg( ENVIRONMENT* env, const char* fmt, ... ) {
         env->statClock.Reset();
     }
 
+    /// === Stats Text ===
+    bool newStats = false;
+    if ( env->statTimeEla >= 1.0 ) {
+        env->elaSec   = env->secondsDone;
+        env->elaMin   = static_cast<int32_t>( env->elaSec / 60 );
+        env->elaHour  = env->elaMin / 60;
+        env->elaDay   = env->elaHour / 24;
+        env->elaYear  = env->elaDay / 365;
+        // Now correct minutes and seconds:
+        env->elaSec  -=  60 * env->elaMin;
+        env->elaMin  -=  60 * env->elaHour;
+        env->elaHour -=  24 * env->elaDay;
+        env->elaDay  -= 365 * env->elaYear;
+
+        // The writers report how many pictures wait and how long the last one took
+        char writerMsg[64] = "";
+        if ( env->frameWriter )
+            pwx_snprintf( writerMsg, 63, "; Queue: %d / %d, %.1f ms", env->frameWriter->getDepth(),
+                          env->frameWriter->getMaxQueue(), env->frameWriter->getEncLast() );
+
+        // Once dust spheres are chained, the arena reports its peak and what did not fit
+        char dustMsg[64] = "";
+        if ( env->dustArena && env->dustArena->getPeak() )
+            pwx_snprintf( dustMsg, 63, "; Dust: %ld / %ld, %ld dropped", env->dustArena->getPeak(),
+                          env->dustArena->capacity(), env->statDustDrop );
+
+        // Note: For a reason I do not understand, yet, SFML does not print s², so Acc is m/ss
+        pwx_snprintf( env->statMsg, 255, "[%d] %d y, % 3d d, % 2d:%02d:%02ld (Acc: %g m/ss; Mov: %g m/s; Coll: %ld / %ld / %ld, %ld skipped; Hidden: %ld; Merged: %ld%s%s)",
+                      env->picNum,
+                      env->elaYear, env->elaDay, env->elaHour, env->elaMin, env->elaSec,
+                      env->statMaxAccel, env->statMaxMove, env->statCollMerge, env->statCollSwept, env->statCollCand, env->statCollSkip,
+                      env->statHidden, env->statLodMerged, dustMsg, writerMsg );
+
+        env->statTimeEla = 0.0;
+        newStats         = true;
+    }
+
+    // Without a window the progress is only written once per second:
+    if ( env->doHeadless ) {
+        if ( newStats )
+            writeStatus( env );
+        return;
+    }
+
+    env->screen->Clear();
+    env->screen->Draw( sf::Sprite( env->image ) );
+
     /// === Text Message ===
     // Set the text for the message first, we need its size
     sf::String sMsg( env->msg, *( env->font ), env->fontSize );
@@ -370,28 +976,7 @@ void showMsg( ENVIRONMENT* env, const char* fmt, ... ) {
     // Draw the text:
     env->screen->Draw( sMsg );
 
-    /// === Stats Text ===
-    if ( env->statTimeEla >= 1.0 ) {
-        env->elaSec   = env->secondsDone;
-        env->elaMin   = static_cast<int32_t>( env->elaSec / 60 );
-        env->elaHour  = env->elaMin / 60;
-        env->elaDay   = env->elaHour / 24;
-        env->elaYear  = env->elaDay / 365;
-        // Now correct minutes and seconds:
-        env->elaSec  -=  60 * env->elaMin;
-        env->elaMin  -=  60 * env->elaHour;
-        env->elaHour -=  24 * env->elaDay;
-        env->elaDay  -= 365 * env->elaYear;
-
-        // Note: For a reason I do not understand, yet, SFML does not print s², so Acc is m/ss
-        pwx_snprintf( env->statMsg, 255, "[%d] %d y, % 3d d, % 2d:%02d:%02ld (Acc: %g m/ss; Mov: %g m/s)",
-                      env->picNum,
-                      env->elaYear, env->elaDay, env->elaHour, env->elaMin, env->elaSec,
-                      env->statMaxAccel, env->statMaxMove );
-
-        env->statTimeEla = 0.0;
-    }
-
+    /// === Stats Box ===
     // Set the text for the message first, we need its size
     sf::String sStat( env->statMsg, *( env->font ), env->fontSize );
     sStat.SetColor( sf::Color( 0x90, 0xC0, 0xFF ) );
@@ -444,7 +1029,52 @@ int32_t sorting( ENVIRONMENT* env, int32_t* unsorted ) {
 }
 
 
+// Thread Function for preparing the projection of all units for the tile renderer and the ray caster
+void thrdBins( void* xEnv ) {
+    threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
+    ENVIRONMENT* env     = thrdEnv->env;
+    int32_t      tNum    = thrdEnv->threadNum;
+    int32_t      tPart   = tNum % env->numThreads; // The part of the work, tNum counts on in the renderer group
+
+    // Kick it!
+    delete thrdEnv;
+
+    int32_t      maxUnit  = static_cast<int32_t>( mProj.size() );
+    int32_t      portion  = static_cast<int32_t>( maxUnit / env->numThreads ); // How many items we prepare
+    int32_t      start    = portion * tPart; // The first number to fetch
+    int32_t      stop     = tPart == ( env->numThreads - 1 ) ? maxUnit : portion * ( tPart + 1 ); // the last number to fetch
+    int64_t      hidCnt   = 0; // Number of units hidden behind nearer masses
+
+    env->lock();
+    env->threadPrg[tNum] = 0;
+    env->threadRun[tNum] = true;
+    env->unlock();
+
+    for ( int32_t lNr = start; env->doWork && ( lNr < stop ); ++lNr ) {
+        sProjInfo& info = mProj[lNr];
+
+        // thrdView() has left out units that are gone
+        if ( info.unit && info.isVisible && !info.unit->prepProject( env, info ) )
+            ++hidCnt;
+
+        // Record our progress, the units left out count as done
+        env->threadPrg[tNum]++;
+
+        // Now if we are told to pause action, do so:
+        while ( env->doPause && env->doWork )
+            pwx_sleep( 50 );
+    } // End of loop
+
+    // Tell env that we are finished:
+    env->lock();
+    env->statHidden     += hidCnt;
+    env->threadRun[tNum] = false;
+    env->unlock();
+}
+
+
 // Thread Function for collision checking
+// Note: The units are only looked at here, the colliding pairs are merged by thrdMerge() afterwards
 void thrdCheck( void* xEnv ) {
     threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
     ENVIRONMENT* env     = thrdEnv->env;
@@ -453,76 +1083,181 @@ void thrdCheck( void* xEnv ) {
     // Kick it!
     delete thrdEnv;
 
-    matContInt   lContInt( mCont ); // Interface for lNr
-    matContInt   rContInt( mCont ); // Interface for rNr
-    int32_t      maxUnit = lContInt.size();
+    int32_t      maxUnit = static_cast<int32_t>( mSnap.size() );
     CMatter*     unit    = NULL;
     CMatter*     other   = NULL;
     bool         away    = false;
+    int64_t      candCnt = 0; // Number of pairs handed to isColliding()
+    int64_t      skipCnt = 0; // Number of units that could not touch anything
+    int64_t      swptCnt = 0; // Number of pairs only the sweep has found, they do not touch any more (--ccd only)
+    double       stepMod = env->universe->M2Pos * env->secPFmod; // Movement to step length
+    double       sweeps  = env->doSweep ? stepMod : 0.; // Step length factor for the broad-phase ranges
+    double       maxStep = stepMod * env->statMaxMove; // Largest step any unit made
+    double       gap     = 0.;
+    double       toi     = 1.;
+    std::vector<int32_t> nearUnits; // Candidates found by the broad-phase
 
     env->lock();
     env->threadPrg[tNum] = 0;
     env->threadRun[tNum] = true;
     env->unlock();
 
-    for ( int32_t lNr = tNum; env->doWork && ( lNr < maxUnit ); lNr += env->numThreads ) {
-        // Get Unit to work with
-        unit = lContInt[lNr];
-        away = false;
+    try {
+        for ( int32_t lNr = tNum; env->doWork && ( lNr < maxUnit ); lNr += env->numThreads ) {
+            unit = mSnap[lNr];
+
+            /* The gap gate: Each unit knows a lower bound of its gap to the nearest unit.
+             * Since the last check it can have shrunk by no more than the own step plus
+             * the largest step of all units. If it is still positive, the unit can not
+             * touch anything, not even in between (--ccd), and is skipped.
+             */
+            gap = unit->getCollGap() - ( stepMod * unit->getMovement() ) - maxStep;
+            unit->setCollGap( gap );
+
+            if ( unit->destroyed() )
+                nearUnits.clear();
+            else if ( env->collGate && ( gap > 0. ) ) {
+                nearUnits.clear();
+                ++skipCnt;
+            } else if ( ECM_GRID == env->collMode ) {
+                /* The broad-phases deliver all units within the collision range plus the
+                 * skin, so the gap can be measured on both sides of lNr.
+                 * grid: lNr is the container number, candidates are in the adjacent cells
+                 * sap : lNr is the sweep position, candidates overlap on all three axes
+                 * bvh : lNr is the leaf order position, candidates have overlapping boxes
+                 */
+                env->collGrid->neighbours( lNr, nearUnits );
+            } else if ( ECM_SAP == env->collMode )
+                env->collSap->overlaps( lNr, nearUnits );
+            else if ( ECM_BVH == env->collMode )
+                env->collBvh->overlaps( lNr, nearUnits );
+            else {
+                nearUnits.clear();
+
+                /* To not miss very large objects that might wait lurking somewhere, we have to search in
+                 * both directions. Once towards the center and once away from it.
+                 */
+
+                // --- First loop: Search towards the center ---
+                away = false;
+                for ( int32_t rNr = lNr - 1; env->doWork && !away && ( rNr >= 0 ); --rNr ) {
+                    // Get Unit to check against
+                    other = mSnap[rNr];
+                    double fullRange = env->universe->M2Pos // The minimum meter in positional coordinates
+                                       + (   env->universe->M2Pos // Now used as a multiplier, because the units
+                                             * ( unit->getRadius() + other->getRadius() ) // radii are in meters
+                                         )
+                                       + ( sweeps * ( unit->getMovement() + other->getMovement() ) ) // --ccd
+                                       + env->collSkin;
+                    if ( other->distDiff( unit ) <= fullRange )
+                        // They are in the same distance area, so check whether they are neighbors:
+                        nearUnits.push_back( rNr );
+                    else
+                        // The other items are no longer in the same distance area
+                        away = true;
+                } // End of first loop
+
+                // --- Second loop: Search away from center ---
+                away = false;
+                for ( int32_t rNr = lNr + 1; env->doWork && !away && ( rNr < maxUnit ); ++rNr ) {
+                    // Get Unit to check against
+                    other = mSnap[rNr];
+                    double fullRange = env->universe->M2Pos // The minimum meter in positional coordinates
+                                       + (   env->universe->M2Pos // Now used as a multiplier, because the units
+                                             * ( unit->getRadius() + other->getRadius() ) // radii are in meters
+                                         )
+                                       + ( sweeps * ( unit->getMovement() + other->getMovement() ) ) // --ccd
+                                       + env->collSkin;
+                    if ( unit->distDiff( other ) <= fullRange )
+                        // They are in the same distance area, so check whether they are neighbors:
+                        nearUnits.push_back( rNr );
+                    else
+                        // The other items are no longer in the same distance area
+                        away = true;
+                } // End of second loop
+            } // End of radial scan
+
+            if ( !unit->destroyed() && !( env->collGate && ( gap > 0. ) ) ) {
+                /* Measure the gap anew. Units the broad-phase did not deliver are at least
+                 * the skin away. Every pair is seen from both sides, but only noted once.
+                 */
+                gap = env->collSkin;
+                for ( size_t rIdx = 0; env->doWork && ( rIdx < nearUnits.size() ); ++rIdx ) {
+                    other = mSnap[nearUnits[rIdx]];
+                    if ( other->destroyed() )
+                        continue;
+                    double otherGap = unit->getGap( env, other );
+                    if ( otherGap < gap )
+                        gap = otherGap;
+                    if ( nearUnits[rIdx] > lNr ) {
+                        ++candCnt;
+                        if ( unit->isColliding( env, other, &toi ) ) {
+                            env->collGraph->addPair( tNum, lNr, nearUnits[rIdx], toi );
+                            // Only a pair that does not touch any more was caught by the sweep alone
+                            if ( env->doSweep && ( otherGap >= 0. ) )
+                                ++swptCnt;
+                        }
+                    }
+                }
+                unit->setCollGap( gap );
+            }
 
-        /* To not miss very large objects that might wait lurking somewhere, we have to search in
-         * both directions. Once towards the center and once away from it.
-         */
+            // Finally record our progress
+            env->threadPrg[tNum]++;
 
-        // --- First loop: Search towards the center ---
-        for ( int32_t rNr = lNr - 1; env->doWork && !unit->destroyed() && !away && ( rNr >= 0 ); --rNr ) {
-            // Get Unit to check against
-            other = rContInt[rNr];
-            double fullRange = env->universe->M2Pos // The minimum meter in positional coordinates
-                               + (   env->universe->M2Pos // Now used as a multiplier, because the units
-                                     * ( unit->getRadius() + other->getRadius() ) // radii are in meters
-                                 );
-            if ( other->distDiff( unit ) <= fullRange ) {
-                // They are in the same distance area, so check whether they are neighbors:
-                other->lock();
-                if ( !other->destroyed() && !unit->destroyed() )
-                    other->applyCollision( env, unit );
-                other->unlock();
-            } else
-                // The other items are no longer in the same distance area
-                away = true;
-        } // End of first loop
-
-        // --- Second loop: Search away from center ---
-        away = false;
-        for ( int32_t rNr = lNr + 1; env->doWork && !unit->destroyed() && !away && ( rNr < maxUnit ); ++rNr ) {
-            // Get Unit to check against
-            other = rContInt[rNr];
-            double fullRange = env->universe->M2Pos // The minimum meter in positional coordinates
-                               + (   env->universe->M2Pos // Now used as a multiplier, because the units
-                                     * ( unit->getRadius() + other->getRadius() ) // radii are in meters
-                                 );
-            if ( unit->distDiff( other ) <= fullRange ) {
-                // They are in the same distance area, so check whether they are neighbors:
-                unit->lock();
-                if ( !unit->destroyed() && !other->destroyed() )
-                    unit->applyCollision( env, other );
-                unit->unlock();
-            } else
-                // The other items are no longer in the same distance area
-                away = true;
-        } // End of second loop
-
-        // Finally record our progress
+            // Now if we are told to pause action, do so:
+            while ( env->doPause && env->doWork )
+                pwx_sleep( 50 );
+        } // End of outer loop
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the collision pair list of thread " << tNum << "! [" << e.what() << "]" << endl;
+        env->doWork = false;
+    }
+
+    // Tell env that we are finished:
+    env->lock();
+    env->statCollCand  += candCnt;
+    env->statCollSkip  += skipCnt;
+    env->statCollSwept += swptCnt;
+    env->threadRun[tNum] = false;
+    env->unlock();
+}
+
+
+// Thread Function for merging the groups of colliding units found by thrdCheck()
+// Note: Every group belongs to exactly one thread, so no locking of the units is needed
+void thrdMerge( void* xEnv ) {
+    threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
+    ENVIRONMENT* env     = thrdEnv->env;
+    int32_t      tNum    = thrdEnv->threadNum;
+
+    // Kick it!
+    delete thrdEnv;
+
+    CCollGraph*  graph    = env->collGraph;
+    int32_t      maxGroup = graph->groups();
+    int64_t      mergCnt  = 0; // Number of units merged into others
+
+    env->lock();
+    env->threadPrg[tNum] = 0;
+    env->threadRun[tNum] = true;
+    env->unlock();
+
+    for ( int32_t gNr = tNum; env->doWork && ( gNr < maxGroup ); gNr += env->numThreads ) {
+        mergCnt += CMatter::applyCollision( env, mSnap.data(), graph->getGroup( gNr ), graph->getGroupSize( gNr ),
+                                            env->collLog, tNum, graph->getImpacts() );
+
+        // Record our progress
         env->threadPrg[tNum]++;
 
         // Now if we are told to pause action, do so:
         while ( env->doPause && env->doWork )
             pwx_sleep( 50 );
-    } // End of outer loop
+    } // End of loop
 
     // Tell env that we are finished:
     env->lock();
+    env->statCollMerge += mergCnt;
     env->threadRun[tNum] = false;
     env->unlock();
 }
@@ -533,83 +1268,100 @@ void thrdDraw( void* xEnv ) {
     threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
     ENVIRONMENT* env     = thrdEnv->env;
     int32_t      tNum    = thrdEnv->threadNum;
+    int32_t      tPart   = tNum % env->numThreads; // The part of the work, tNum counts on in the renderer group
 
     // Kick it!
     delete thrdEnv;
 
     size_t maxX  = env->scrWidth;
     size_t maxY  = env->scrHeight;
-    size_t start = tNum;
+    size_t start = tPart;
     size_t jump  = env->numThreads;
 
+    // Scratch space for sorting the dust spheres of a pixel with EDM_SORT
+    std::vector<sDustFrag> frags;
+
+    // The dust sphere chains of CDustBlend::lanes pixels are blended at once
+    CDustBlend blend;
+
     env->lock();
     env->threadPrg[tNum] = 0;
     env->threadRun[tNum] = true;
     env->unlock();
 
-    // Every thread draws its own pixels, there won't be any concurrency.
-    for ( size_t x = 0; env->doWork && ( x < maxX ); ++x ) {
-        for ( size_t y = start; env->doWork && ( y < maxY ); y += jump ) {
-            uint8_t r = 0, g = 0, b = 0;
-            double z = -2.0;
-
-            // Step 1: Check Mass Map
-            if ( env->zMassMap[x][y].z > -0.5 ) {
-                // There is a mass, get the relevant values then:
-                r = env->zMassMap[x][y].r;
-                g = env->zMassMap[x][y].g;
-                b = env->zMassMap[x][y].b;
-                z = env->zMassMap[x][y].z;
-                // And reset the mass, we don't need it any more:
-                env->zMassMap[x][y].invalidate();
-            }
-
-            // Step 2: Walk through the zDustMap and add up our colors
-            if ( env->zDustMap[x][y].z > -1.5 ) {
-                sDustPixel* dust = &env->zDustMap[x][y];
-                while ( dust ) {
-                    assert ( ( ( z < 0. ) || ( dust->z < z ) )
-                             && "ERROR: zDustMap has not been correctly invalidated somewhere! Dust behind Mass detected!" );
-                    if ( ( dust->z > 0. ) && ( ( z < 0. ) || ( dust->z < z ) ) ) {
-                        double dustOpaq = dust->range / dust->maxRange;
-                        double dustTran = 1.0 - dustOpaq;
-
-                        if ( dustTran > 0.005 ) {
-                            // The dust sphere is transparent enough, calculate the color
-                            r = static_cast<uint8_t>( std::round( ( static_cast<double>( r ) * dustTran )
-                                                                 +( static_cast<double>( dust->r ) * dustOpaq ) ) );
-                            g = static_cast<uint8_t>( std::round( ( static_cast<double>( g ) * dustTran )
-                                                                 +( static_cast<double>( dust->g ) * dustOpaq ) ) );
-                            b = static_cast<uint8_t>( std::round( ( static_cast<double>( b ) * dustTran )
-                                                                 +( static_cast<double>( dust->b ) * dustOpaq ) ) );
-                        } else {
-                            // The dust sphere is opaque, overwrite our colors with the dust sphere colors
-                            r = dust->r;
-                            g = dust->g;
-                            b = dust->b;
-                        }
+    // Every thread draws its own rows, there won't be any concurrency.
+    // Note: The zMaps and env->frameBuf are row-major, so the rows are walked from left to right.
+    for ( size_t y = start; env->doWork && ( y < maxY ); y += jump ) {
+        uint8_t* pixel = &env->frameBuf[y * maxX * 4];
+
+        // The pixels are taken in batches, so CDustBlend can blend their dust sphere chains at once
+        for ( size_t first = 0; env->doWork && ( first < maxX ); first += CDustBlend::lanes ) {
+            size_t last = std::min( first + CDustBlend::lanes, maxX );
+            blend.start();
+
+            for ( size_t x = first; x < last; ++x ) {
+                int32_t lane = static_cast<int32_t>( x - first );
+                uint8_t r = 0, g = 0, b = 0;
+                double  z = -2.0;
+
+                // Step 1: Check Mass Map
+                if ( env->zMassMap[y][x].getZ() > -0.5 ) {
+                    // There is a mass, get the relevant values then:
+                    env->zMassMap[y][x].getColor( r, g, b );
+                    z = env->zMassMap[y][x].getZ();
+                    // And reset the mass, we don't need it any more:
+                    env->zMassMap[y][x].invalidate();
+                }
 
-                        // Finally invalidate this:
-                        dust->invalidate();
-                    } // end of having a drawable dust sphere
-                    // And move on:
-                    dust = dust->next;
-                } // end of looping through all dust sphere entries
-                // The whole dust sphere chain is empty now:
-                env->zDustMap[x][y].z = -2.0;
-            } // end of having at least one dust sphere entry
-            // Step 3: If we have a resulting color, draw it:
-            if ( r || g || b ) {
-                env->lock();
-                env->image.SetPixel( x, y, sf::Color( r, g, b ) );
-                env->unlock();
+                // Step 2: Walk through the zDustMap and collect the dust spheres to blend over our colors
+                if ( EDM_SORT == env->dustMode ) {
+                    // The chain is not ordered, the dust spheres have to be sorted and are blended right away
+                    if ( EXIT_FAILURE == env->resolveDust( x, y, z, r, g, b, frags ) ) {
+                        env->lock();
+                        env->doWork = false; // this'll end all threads and the program itself.
+                        env->unlock();
+                    }
+                    blend.setBase( lane, r, g, b );
+                } else {
+                    blend.setBase( lane, r, g, b );
+                    if ( env->zDustMap[y][x].z > -1.5 ) {
+                        sDustPixel* dust = &env->zDustMap[y][x];
+                        while ( dust ) {
+                            assert ( ( ( z < 0. ) || ( dust->z < z ) )
+                                     && "ERROR: zDustMap has not been correctly invalidated somewhere! Dust behind Mass detected!" );
+                            if ( ( dust->z > 0. ) && ( ( z < 0. ) || ( dust->z < z ) ) ) {
+                                if ( EXIT_FAILURE == blend.add( lane, dust->r, dust->g, dust->b, dust->range / dust->maxRange ) ) {
+                                    env->lock();
+                                    env->doWork = false; // this'll end all threads and the program itself.
+                                    env->unlock();
+                                }
+
+                                // Finally invalidate this:
+                                dust->invalidate();
+                            } // end of having a drawable dust sphere
+                            // And move on:
+                            dust = dust->next;
+                        } // end of looping through all dust sphere entries
+                        // The whole dust sphere chain is empty now:
+                        env->zDustMap[y][x].z = -2.0;
+                    } // end of having at least one dust sphere entry
+                }
+                // The chained pixels go back to the dust arena once all are drawn:
+                env->zDustMap[y][x].next = NULL;
+            } // end of collecting the batch
+
+            // Step 3: Blend the batch and draw the resulting colors, black overwrites what the last picture has left
+            blend.blend();
+            for ( size_t x = first; x < last; ++x, pixel += 4 ) {
+                blend.getColor( static_cast<int32_t>( x - first ), pixel[0], pixel[1], pixel[2] );
+                pixel[3] = 255;
             }
 
             // Now if we are told to pause action, do so:
             while ( env->doPause && env->doWork )
                 pwx_sleep( 50 );
-        } // end of y-loop
-    } // end of x-loop
+        } // end of x-loop
+    } // end of y-loop
 
     // Tell env that we are finished:
     env->lock();
@@ -1048,16 +1800,16 @@ void thrdProj( void* xEnv ) {
     threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
     ENVIRONMENT* env     = thrdEnv->env;
     int32_t      tNum    = thrdEnv->threadNum;
+    int32_t      tPart   = tNum % env->numThreads; // The part of the work, tNum counts on in the renderer group
 
     // Kick it!
     delete thrdEnv;
 
-    matContInt   lContInt( mCont );
-    int32_t      maxUnit  = lContInt.size();
-    CMatter*     unit     = NULL;
+    int32_t      maxUnit  = static_cast<int32_t>( mProj.size() );
     int32_t      portion  = static_cast<int32_t>( maxUnit / env->numThreads ); // How many items we draw
-    int32_t      start    = portion * tNum; // The first number to fetch
-    int32_t      stop     = tNum == ( env->numThreads - 1 ) ? maxUnit : portion * ( tNum + 1 ); // the last number to fetch
+    int32_t      start    = portion * tPart; // The first number to fetch
+    int32_t      stop     = tPart == ( env->numThreads - 1 ) ? maxUnit : portion * ( tPart + 1 ); // the last number to fetch
+    int64_t      hidCnt   = 0; // Number of units hidden behind nearer masses
 
     env->lock();
     env->threadPrg[tNum] = 0;
@@ -1065,17 +1817,19 @@ void thrdProj( void* xEnv ) {
     env->unlock();
 
     for ( int32_t lNr = start; env->doWork && ( lNr < stop ); ++lNr ) {
-        // Get Unit to work with
-        unit = lContInt[lNr];
+        // Get the view thrdView() has prepared, units that are gone have none
+        sProjInfo& info = mProj[lNr];
 
         // Draw the unit
-        if ( env->doWork && !unit->gone( env ) ) {
-            if ( EXIT_FAILURE == unit->project( env ) ) {
+        if ( env->doWork && info.unit ) {
+            bool wasVisible = info.isVisible;
+            if ( EXIT_FAILURE == info.unit->project( env, info ) ) {
                 // This means we have had an exception (probably bad_alloc) and need to exit.
                 env->lock();
                 env->doWork = false; // this'll end all threads and the program itself.
                 env->unlock();
-            }
+            } else if ( wasVisible && !info.isVisible )
+                ++hidCnt;
             // Record our progress
             env->threadPrg[tNum]++;
         }
@@ -1087,11 +1841,81 @@ void thrdProj( void* xEnv ) {
 
     // Tell env that we are finished:
     env->lock();
+    env->statHidden     += hidCnt;
     env->threadRun[tNum] = false;
     env->unlock();
 }
 
 
+// Thread Function for tracing whole rows of pixels through the hierarchy of the ray caster
+// Note: Every row of env->frameBuf belongs to exactly one thread, so no locking is needed
+void thrdRay( void* xEnv ) {
+    threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
+    ENVIRONMENT* env     = thrdEnv->env;
+    int32_t      tNum    = thrdEnv->threadNum;
+    int32_t      tPart   = tNum % env->numThreads; // The part of the work, tNum counts on in the renderer group
+
+    // Kick it!
+    delete thrdEnv;
+
+    const CRayBVH* bvh  = env->rayBvh;
+    int32_t        maxX = env->scrWidth;
+    int32_t        maxY = env->scrHeight;
+
+    // Scratch space for the dust sphere parts of a pixel
+    std::vector<sDustFrag> frags;
+
+    env->lock();
+    env->threadPrg[tNum] = 0;
+    env->threadRun[tNum] = true;
+    env->unlock();
+
+    for ( int32_t y = tPart; env->doWork && ( y < maxY ); y += env->numThreads ) {
+        uint8_t* pixel = &env->frameBuf[static_cast<size_t>( y ) * maxX * 4];
+        for ( int32_t x = 0; env->doWork && ( x < maxX ); ++x, pixel += 4 ) {
+            uint8_t r = 0, g = 0, b = 0;
+            if ( EXIT_FAILURE == bvh->trace( env, x, y, r, g, b, frags ) ) {
+                env->lock();
+                env->doWork = false; // this'll end all threads and the program itself.
+                env->unlock();
+            }
+            // Black overwrites what the last picture has left
+            pixel[0] = r;
+            pixel[1] = g;
+            pixel[2] = b;
+            pixel[3] = 255;
+        }
+
+        // Record our progress
+        env->threadPrg[tNum]++;
+
+        // Now if we are told to pause action, do so:
+        while ( env->doPause && env->doWork )
+            pwx_sleep( 50 );
+    } // End of y-loop
+
+    // Tell env that we are finished:
+    env->lock();
+    env->threadRun[tNum] = false;
+    env->unlock();
+}
+
+
+// Thread Function leading the renderer group with --pipeline, xEnv is the environment itself
+// Note: Steps 8 and 9 of the workLoop are done here on the copies startRender() has taken
+void thrdRend( void* xEnv ) {
+    ENVIRONMENT* env    = static_cast<ENVIRONMENT*>( xEnv );
+    int32_t      result = projUnits( env, 1 );
+
+    if ( env->doWork && ( EXIT_SUCCESS == result ) )
+        traceUnits( env, 1 );
+
+    // Tell finishRender() that we are finished, the picture is complete once it sees this:
+    rendResult.store( result, std::memory_order_release );
+    rendering.store( false, std::memory_order_release );
+}
+
+
 // Thread Function for Movement
 void thrdMove( void* xEnv ) {
     threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
@@ -1175,6 +1999,111 @@ void thrdSort( void* xEnv ) {
 }
 
 
+// Thread Function for projecting the units of whole tiles
+// Note: Every tile belongs to exactly one thread and all pixels written lie inside it, so no locking is needed
+void thrdTile( void* xEnv ) {
+    threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
+    ENVIRONMENT* env     = thrdEnv->env;
+    int32_t      tNum    = thrdEnv->threadNum;
+    int32_t      tPart   = tNum % env->numThreads; // The part of the work, tNum counts on in the renderer group
+
+    // Kick it!
+    delete thrdEnv;
+
+    CTileBins*   bins     = env->tileBins;
+    int32_t      maxTile  = bins->size();
+
+    env->lock();
+    env->threadPrg[tNum] = 0;
+    env->threadRun[tNum] = true;
+    env->unlock();
+
+    for ( int32_t tNr = tPart; env->doWork && ( tNr < maxTile ); tNr += env->numThreads ) {
+        const int32_t* bin     = bins->getBin( tNr );
+        int32_t        binSize = bins->getBinSize( tNr );
+        sTileRect      clip    = bins->getRect( tNr );
+
+        // The bin is in container order, so every pixel sees the units in the same order
+        for ( int32_t bNr = 0; env->doWork && ( bNr < binSize ); ++bNr ) {
+            const sProjInfo& info = mProj[bin[bNr]];
+            if ( EXIT_FAILURE == info.unit->projectTile( env, info, clip ) ) {
+                // This means we have had an exception (probably bad_alloc) and need to exit.
+                env->lock();
+                env->doWork = false; // this'll end all threads and the program itself.
+                env->unlock();
+            }
+        }
+
+        // Record our progress
+        env->threadPrg[tNum]++;
+
+        // Now if we are told to pause action, do so:
+        while ( env->doPause && env->doWork )
+            pwx_sleep( 50 );
+    } // End of loop
+
+    // Tell env that we are finished:
+    env->lock();
+    env->threadRun[tNum] = false;
+    env->unlock();
+}
+
+
+/// @brief determine where @a unit is drawn and store it as projection @a lNr, helper of thrdView()
+static void viewUnit( ENVIRONMENT* env, CMatter* unit, int32_t lNr, int32_t tNum ) {
+    // Units that are gone are neither drawn nor do their rings grow any more
+    if ( unit->gone( env ) ) {
+        mProj[lNr].unit      = NULL;
+        mProj[lNr].isVisible = false;
+    } else {
+        unit->prepView( env, mProj[lNr] );
+        // Record our progress
+        env->threadPrg[tNum]++;
+    }
+
+    // Now if we are told to pause action, do so:
+    while ( env->doPause && env->doWork )
+        pwx_sleep( 50 );
+}
+
+
+// Thread Function for determining where all units are drawn
+void thrdView( void* xEnv ) {
+    threadEnv*   thrdEnv = static_cast<threadEnv*>( xEnv );
+    ENVIRONMENT* env     = thrdEnv->env;
+    int32_t      tNum    = thrdEnv->threadNum;
+    int32_t      tPart   = tNum % env->numThreads; // The part of the work, tNum counts on in the renderer group
+
+    // Kick it!
+    delete thrdEnv;
+
+    int32_t      maxUnit  = static_cast<int32_t>( mProj.size() ); // projUnits() has made room for all units
+    int32_t      portion  = static_cast<int32_t>( maxUnit / env->numThreads ); // How many items we prepare
+    int32_t      start    = portion * tPart; // The first number to fetch
+    int32_t      stop     = tPart == ( env->numThreads - 1 ) ? maxUnit : portion * ( tPart + 1 ); // the last number to fetch
+
+    env->lock();
+    env->threadPrg[tNum] = 0;
+    env->threadRun[tNum] = true;
+    env->unlock();
+
+    // The renderer group of --pipeline takes the copies startRender() has taken and leaves mCont alone
+    if ( tNum != tPart ) {
+        for ( int32_t lNr = start; env->doWork && ( lNr < stop ); ++lNr )
+            viewUnit( env, &mCopy[lNr], lNr, tNum );
+    } else {
+        matContInt lContInt( mCont );
+        for ( int32_t lNr = start; env->doWork && ( lNr < stop ); ++lNr )
+            viewUnit( env, lContInt[lNr], lNr, tNum );
+    }
+
+    // Tell env that we are finished:
+    env->lock();
+    env->threadRun[tNum] = false;
+    env->unlock();
+}
+
+
 int32_t workLoop( ENVIRONMENT* env ) {
     int32_t    result       = EXIT_SUCCESS;
     char       picName[256] = "";
@@ -1186,8 +2115,7 @@ int32_t workLoop( ENVIRONMENT* env ) {
     if ( !env->isLoaded ) {
         // 1.: Save the initial picture
         pwx_snprintf( picName, 255, env->outFileFmt.c_str(), ++env->picNum );
-        showMsg( env, "saving picture %s ...", picName );
-        env->image.SaveToFile( std::string( picName ) );
+        savePicture( env, picName, env->secondsDone );
         doEvents( env );
 
         // 2.: Create the initial save file
@@ -1210,12 +2138,15 @@ int32_t workLoop( ENVIRONMENT* env ) {
     }
 
 
-    while ( env->doWork && ( EXIT_SUCCESS == result ) && env->screen->IsOpened() && ( mCont->size() > 1 ) ) {
+    while ( env->doWork && ( EXIT_SUCCESS == result ) && ( env->doHeadless || env->screen->IsOpened() )
+            && ( mCont->size() > 1 ) ) {
         bool doGrav = env->needGravCalc();
 
         // If we shall save, we save now:
         if ( env->saveFile.size() && ( doGrav || !( env->secondsDone % 60 ) ) ) {
             // Note: This means we save whenever a new gravitation calculation is needed or a minute is done
+            // With --pipeline the picture in work is finished first, so the picture number saved fits.
+            result = finishRender( env, picName );
             showMsg( env, "Saving %d items...", iCont.size() );
             save( env );
         }
@@ -1237,6 +2168,10 @@ int32_t workLoop( ENVIRONMENT* env ) {
          * 11. Save the image
          * 12. Advance to the next frame and check whether it needs the same second. If it does, continue with 5.
          * 13. Eventually clean up the units.
+         *
+         * With --pipeline the steps 8 to 11 are done by thrdRend() with its own group of threads on
+         * copies of the units, while the next seconds are calculated. The picture is shown and saved
+         * once the next frame needs the renderer, see finishRender() and startRender().
         **/
 
         /// === Step 1 ===
@@ -1296,52 +2231,35 @@ int32_t workLoop( ENVIRONMENT* env ) {
             /// === Step 7 ===
             /// Check for collisions
             if ( env->doWork && doCollision ) {
-                env->startThreads( &thrdCheck );
-                waitThrd( env, "Collisions" );
-                env->clearThreads();
+                result = checkColl( env );
             }
 
             /// Steps 8 to 13 are skipped unless the current frame needs the second the cycle is in
             if ( env->doWork && ( env->secPerFrame[env->currFrame] == secInCycle ) ) {
-                /// === Step 8 ===
-                /// Project all units relative to the projection plane
-                if ( env->doWork ) {
-                    // Clear image first
-                    env->image.Create( env->scrWidth, env->scrHeight );
-
-                    // Now project all masses with their dust spheres
-                    env->setDynamicZ();
-                    env->startThreads( &thrdProj );
-                    waitThrd( env, "Projecting..." );
-                    env->clearThreads();
-                }
-
-                /// === Step 9 ===
-                /// Trace image pixels from camera to source
-                if ( env->doWork ) {
-                    env->startThreads( &thrdDraw );
-                    waitThrd( env, "Tracing..." );
-                    env->clearThreads();
-                }
+                if ( env->doPipeline ) {
+                    /// === Steps 8 to 11 with --pipeline ===
+                    /// The picture of the frame before is shown and saved once the renderer is finished with
+                    /// it, then the renderer draws copies of the units while the next seconds are calculated.
+                    result = finishRender( env, picName );
+                    if ( env->doWork && ( EXIT_SUCCESS == result ) )
+                        result = startRender( env );
+                } else {
+                    /// === Step 8 ===
+                    /// Project all units relative to the projection plane
+                    // Note: The tracing threads overwrite every pixel of env->frameBuf, it needs no clearing
+                    if ( env->doWork ) {
+                        env->setDynamicZ();
+                        result = projUnits( env );
+                    }
 
-                /// === Step 10 ===
-                /// Update screen
-                if ( env->doWork ) {
-                    env->screen->Clear();
-                    env->screen->Draw( sf::Sprite( env->image ) );
-                    env->screen->Display();
-                    // Process events to get out early if wanted:
-                    doEvents( env );
-                }
+                    /// === Step 9 ===
+                    /// Trace image pixels from camera to source
+                    if ( env->doWork )
+                        traceUnits( env, 0 );
 
-                /// === Step 11 ===
-                /// Save the image
-                if ( env->doWork ) {
-                    // save the image
-                    pwx_snprintf( picName, 255, env->outFileFmt.c_str(), ++env->picNum );
-                    // Only show message if doWork is true, or the screen might have gone away!
-                    showMsg( env, "saving picture %s ...", picName );
-                    env->image.SaveToFile( std::string( picName ) );
+                    /// === Steps 10 and 11 ===
+                    /// Update screen and save the image
+                    putPicture( env, picName, env->secondsDone );
                 }
 
                 /// === Step 12 ===
@@ -1383,12 +2301,19 @@ int32_t workLoop( ENVIRONMENT* env ) {
         if ( env->doWork && !doCollision ) {
             doCollision = true;
             // Now check collisions at the end of second 1:
-            env->startThreads( &thrdCheck );
-            waitThrd( env, "Collisions" );
-            env->clearThreads();
+            result = checkColl( env );
         }
     } // end main loop
 
+    // The last picture of --pipeline is still being drawn
+    int32_t rendRes = finishRender( env, picName );
+    if ( EXIT_SUCCESS == result )
+        result = rendRes;
+
+    // Every picture handed over has to be saved before the program ends
+    if ( env->frameWriter )
+        env->frameWriter->stop();
+
     return ( result );
 }
 
@@ -23,24 +23,33 @@
 
 #include "main.h"
 
+int32_t checkColl( ENVIRONMENT* env );
 void    cleanup  ();
 void    doEvents ( ENVIRONMENT* env );
 double  getSimOff( double x, double y, double z, double zoom );
 int32_t initSFML ( ENVIRONMENT* env );
-int32_t running  ( ENVIRONMENT* env, int32_t* progress );
+int32_t prepColl ( ENVIRONMENT* env );
+int32_t projUnits( ENVIRONMENT* env, int32_t group = 0 );
+int32_t running  ( ENVIRONMENT* env, int32_t* progress, int32_t group = 0 );
 int32_t save     ( ENVIRONMENT* env );
 void    setSleep ( float pOld, float pCur, float pMax, int32_t* toSleep, int32_t* partSleep );
 void    showMsg  ( ENVIRONMENT* env, const char* fmt, ... );
 int32_t sorting  ( ENVIRONMENT* env, int32_t* progress );
+void    thrdBins ( void* xEnv );
 void    thrdCheck( void* xEnv );
 void    thrdDraw ( void* xEnv );
 void    thrdGrav ( void* xEnv );
 void    thrdInit ( void* xEnv );
 void    thrdImpu ( void* xEnv );
 void    thrdLoad ( void* xEnv );
+void    thrdMerge( void* xEnv );
 void    thrdMove ( void* xEnv );
 void    thrdProj ( void* xEnv );
+void    thrdRay  ( void* xEnv );
+void    thrdRend ( void* xEnv );
 void    thrdSort ( void* xEnv );
+void    thrdTile ( void* xEnv );
+void    thrdView ( void* xEnv );
 int32_t workLoop ( ENVIRONMENT* env );
 void    waitLoad ( ENVIRONMENT* env, const char* fmt, int32_t maxNr );
 void    waitSort ( ENVIRONMENT* env );
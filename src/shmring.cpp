@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <climits>
+#include <new>
+
+#include "shmring.h"
+#include "framewriter.h"
+#include "masspixel.h" // Cache_Line
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#  if defined(__linux__)
+#    include <linux/futex.h>
+#    include <sys/syscall.h>
+#  endif
+#endif
+
+static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( uint32_t ), "The futex word must be a plain 32 bit integer" );
+static_assert( std::atomic<uint64_t>::is_always_lock_free, "The counters must be lock free to be shared between processes" );
+
+
+/// @brief round @a size up to the next full cache line
+static size_t toCacheLine( size_t size ) {
+    return ( ( size + Cache_Line - 1 ) / Cache_Line ) * Cache_Line;
+}
+
+
+/// @brief wake all readers waiting on the futex word @a word, readers elsewhere have to poll
+static void wakeReaders( std::atomic<uint32_t>* word ) {
+#if defined(__linux__)
+    syscall( SYS_futex, reinterpret_cast<uint32_t*>( word ), FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+#else
+    ( void )word;
+#endif
+}
+
+
+/// @brief tell the readers that nothing comes any more, then unmap and remove the memory
+CShmRing::~CShmRing() {
+#if !defined(_WIN32) && !defined(_WIN64)
+    if ( header ) {
+        header->closed.store( 1, std::memory_order_release );
+        header->wakeSeq.fetch_add( 1, std::memory_order_release );
+        wakeReaders( &header->wakeSeq );
+        munmap( header, mapSize );
+        shm_unlink( name.c_str() );
+    }
+#endif
+    header = NULL;
+}
+
+
+/** @brief create the shared memory
+  *
+  * A memory with the same name is removed first, readers that still have it
+  * mapped keep it until they unmap it.
+  *
+  * @param[in] shmName Name of the memory, a leading slash is added if missing
+  * @param[in] slots Number of pictures the ring holds
+  * @param[in] width Width of every picture in pixels
+  * @param[in] height Height of every picture in pixels
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the memory could not be created
+**/
+int32_t CShmRing::open( const char* shmName, int32_t slots, uint32_t width, uint32_t height ) {
+#if defined(_WIN32) || defined(_WIN64)
+    cerr << "ERROR: --shm \"" << shmName << "\" needs POSIX shared memory, which this system lacks!" << endl;
+    ( void )slots;
+    ( void )width;
+    ( void )height;
+    return EXIT_FAILURE;
+#else
+    name = shmName;
+    if ( name.empty() || ( '/' != name[0] ) )
+        name.insert( 0, "/" );
+
+    // 1.: Determine the layout, every slot starts on a cache line
+    size_t headSize = toCacheLine( sizeof( sShmHeader ) );
+    size_t dataSize = static_cast<size_t>( width ) * height * 4;
+    size_t slotSize = toCacheLine( sizeof( sShmSlot ) + dataSize );
+    mapSize = headSize + ( static_cast<size_t>( slots ) * slotSize );
+
+    // 2.: Create and map the memory
+    shm_unlink( name.c_str() );
+    int fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+    if ( fd < 0 ) {
+        cerr << "ERROR: unable to create the shared memory \"" << name << "\"!" << endl;
+        return EXIT_FAILURE;
+    }
+    void* mem = MAP_FAILED;
+    if ( 0 == ftruncate( fd, static_cast<off_t>( mapSize ) ) )
+        mem = mmap( NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( MAP_FAILED == mem ) {
+        cerr << "ERROR: unable to map " << ( mapSize >> 10 ) << " KiB of shared memory for \"" << name << "\"!" << endl;
+        shm_unlink( name.c_str() );
+        return EXIT_FAILURE;
+    }
+
+    // 3.: Write the header and the empty slots, the memory is zeroed already
+    header = new ( mem ) sShmHeader;
+    header->magic     = 0x52534d47; // "GMSR"
+    header->version   = 1;
+    header->headSize  = static_cast<uint32_t>( headSize );
+    header->slotCount = static_cast<uint32_t>( slots );
+    header->width     = width;
+    header->height    = height;
+    header->slotSize  = slotSize;
+    header->dataSize  = dataSize;
+    header->published.store( 0 );
+    header->wakeSeq.store( 0 );
+    header->closed.store( 0 );
+    for ( int32_t i = 0; i < slots; ++i ) {
+        sShmSlot* slot = new ( static_cast<uint8_t*>( mem ) + headSize + ( i * slotSize ) ) sShmSlot;
+        slot->seq.store( 0 );
+    }
+
+    return EXIT_SUCCESS;
+#endif
+}
+
+
+/** @brief copy a picture into the next slot and wake the readers
+  *
+  * @param[in] frame The picture, it must have the size given to open()
+  * @return true if the picture was published
+**/
+bool CShmRing::publish( const sFrame& frame ) {
+    if ( !header || ( frame.width != header->width ) || ( frame.height != header->height ) )
+        return false;
+
+    uint64_t  nr   = header->published.load( std::memory_order_relaxed );
+    sShmSlot* slot = reinterpret_cast<sShmSlot*>( reinterpret_cast<uint8_t*>( header ) + header->headSize
+                     + ( ( nr % header->slotCount ) * header->slotSize ) );
+
+    // 1.: Mark the slot as being written, readers copying it now will notice
+    uint32_t seq = slot->seq.load( std::memory_order_relaxed );
+    slot->seq.store( seq + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    // 2.: Copy the picture
+    slot->number = frame.number;
+    slot->second = frame.second;
+    slot->width  = frame.width;
+    slot->height = frame.height;
+    std::copy( frame.pixels.begin(), frame.pixels.begin() + header->dataSize,
+               reinterpret_cast<uint8_t*>( slot + 1 ) );
+
+    // 3.: Release the slot and announce it
+    slot->seq.store( seq + 2, std::memory_order_release );
+    header->published.store( nr + 1, std::memory_order_release );
+    header->wakeSeq.fetch_add( 1, std::memory_order_release );
+    wakeReaders( &header->wakeSeq );
+
+    return true;
+}
+
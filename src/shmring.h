@@ -0,0 +1,90 @@
+#pragma once
+#ifndef PWX_GRAVMAT_SHMRING_H_INCLUDED
+#define PWX_GRAVMAT_SHMRING_H_INCLUDED 1
+
+#include <atomic>
+#include <string>
+
+#include "environment.h"
+
+// The pictures come out of the frame writer queue:
+struct sFrame;
+
+
+/** @brief Head of the shared memory, it is followed by the slots
+  *
+  * All sizes are in bytes. The memory starts with the magic "GMSR", the
+  * format version and the size of this header, so a reader can check all
+  * that, each as a 32 bit unsigned integer in the byte order of the machine.
+**/
+struct sShmHeader {
+    uint32_t              magic;     //!< "GMSR"
+    uint32_t              version;   //!< Version of the layout, currently 1
+    uint32_t              headSize;  //!< Size of this header with its padding, the first slot starts there
+    uint32_t              slotCount; //!< Number of slots in the ring
+    uint32_t              width;     //!< Width of every picture in pixels
+    uint32_t              height;    //!< Height of every picture in pixels
+    uint64_t              slotSize;  //!< Distance between two slots, including their sShmSlot head
+    uint64_t              dataSize;  //!< Size of the RGBA pixels behind every sShmSlot head
+    std::atomic<uint64_t> published; //!< Number of pictures published so far, the last is in slot (published - 1) % slotCount
+    std::atomic<uint32_t> wakeSeq;   //!< Futex word, changes with every picture and when the ring is closed
+    std::atomic<uint32_t> closed;    //!< Set to 1 once the program stopped publishing
+};
+
+
+/** @brief Head of every slot, the RGBA pixels follow it row by row
+  *
+  * The pixels start sizeof( sShmSlot ), that is 24, bytes after the slot.
+  *
+  * @a seq is a sequence lock: It is odd while the slot is written. A reader
+  * reads it, copies what it wants and reads it again. If both are the same
+  * even value, the copy is complete.
+**/
+struct sShmSlot {
+    std::atomic<uint32_t> seq;    //!< Sequence lock of the slot
+    int32_t               number; //!< Number of the picture, as used in the file names
+    int64_t               second; //!< Simulated second the picture shows
+    uint32_t              width;  //!< Width of the picture in pixels
+    uint32_t              height; //!< Height of the picture in pixels
+};
+
+
+/** @class CShmRing
+  * @brief Ring of pictures in POSIX shared memory, set with --shm
+  *
+  * Viewers, encoders and other tools can map the memory and read the
+  * pictures right where they are, while the writer goes on with the next
+  * slot. Nobody waits for the readers, a reader that is too slow simply
+  * misses pictures, which it can tell from the picture numbers.
+  *
+  * A reader waits for new pictures with FUTEX_WAIT on sShmHeader::wakeSeq
+  * (Linux) or by polling sShmHeader::published. The memory is removed from
+  * the namespace when the ring is destroyed, readers that still have it
+  * mapped can read the last pictures until they unmap it.
+**/
+class CShmRing {
+    sShmHeader* header;  //!< Start of the mapped memory
+    size_t      mapSize; //!< Size of the mapped memory
+    std::string name;    //!< Name of the shared memory, always starting with a slash
+
+  public:
+    /// @brief default ctor, the memory is created by open()
+    explicit CShmRing(): header( NULL ), mapSize( 0 ), name( "" ) { }
+
+    // The dtor tells the readers and removes the memory:
+    ~CShmRing();
+
+    // Create the shared memory:
+    int32_t open( const char* shmName, int32_t slots, uint32_t width, uint32_t height ) PWX_WARNUNUSED;
+
+    // Copy a picture into the next slot and wake the readers:
+    bool    publish( const sFrame& frame );
+
+  private:
+    /* --- no copying! --- */
+    CShmRing( CShmRing& );
+    CShmRing& operator=( CShmRing& );
+};
+
+#endif // PWX_GRAVMAT_SHMRING_H_INCLUDED
+
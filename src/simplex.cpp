@@ -0,0 +1,118 @@
+#include <cmath>
+
+#include "simplex.h"
+
+
+/// @brief The permutation of the reference implementation, twice, so no index has to be wrapped
+static const uint8_t spxPerm[512] = {
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+    140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+    247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+     74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+     60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+    200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+     52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+    119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+    129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+     81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+    184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180,
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+    140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+    247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+     74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+     60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+    200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+     52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+    119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+    129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+     81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+    184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180
+};
+
+/// @brief The twelve gradients pointing to the edge centers of a cube
+static const double spxGrad[12][3] = {
+    { 1., 1., 0. }, { -1., 1., 0. }, { 1., -1., 0. }, { -1., -1., 0. },
+    { 1., 0., 1. }, { -1., 0., 1. }, { 1., 0., -1. }, { -1., 0., -1. },
+    { 0., 1., 1. }, { 0., -1., 1. }, { 0., 1., -1. }, { 0., -1., -1. }
+};
+
+/// @brief return the contribution of the corner with gradient @a gi at the offset @a x / @a y / @a z
+static inline double spxCorner( int32_t gi, double x, double y, double z ) {
+    double t = 0.6 - ( x * x ) - ( y * y ) - ( z * z );
+    if ( t < 0. )
+        return 0.;
+    t *= t;
+    return t * t * ( ( spxGrad[gi][0] * x ) + ( spxGrad[gi][1] * y ) + ( spxGrad[gi][2] * z ) );
+}
+
+
+/** @brief return three dimensional simplex noise at @a x / @a y / @a z
+  *
+  * This follows the reference implementation: The skewed cube the point lies
+  * in is split into six tetrahedra, and the four corners of the one holding
+  * the point add their contributions.
+  *
+  * @param[in] x X-Coordinate to sample
+  * @param[in] y Y-Coordinate to sample
+  * @param[in] z Z-Coordinate to sample
+  * @param[in] zoom All coordinates are divided by this, must not be zero
+  * @return the noise between -1.0 and 1.0
+**/
+double simplex3D( double x, double y, double z, double zoom ) {
+    static const double skew   = 1.0 / 3.0;
+    static const double unskew = 1.0 / 6.0;
+
+    x /= zoom;
+    y /= zoom;
+    z /= zoom;
+
+    // 1.: Find the cube the point lies in and the offset to its origin
+    double  s  = ( x + y + z ) * skew;
+    double  fi = std::floor( x + s );
+    double  fj = std::floor( y + s );
+    double  fk = std::floor( z + s );
+    double  t  = ( fi + fj + fk ) * unskew;
+    double  x0 = x - ( fi - t );
+    double  y0 = y - ( fj - t );
+    double  z0 = z - ( fk - t );
+
+    // 2.: Find the tetrahedron, the second and third corner depend on the order of the offsets
+    int32_t i1, j1, k1, i2, j2, k2;
+    if ( x0 >= y0 ) {
+        if      ( y0 >= z0 ) { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+        else if ( x0 >= z0 ) { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1; }
+        else                 { i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1; }
+    } else {
+        if      ( y0 <  z0 ) { i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1; }
+        else if ( x0 <  z0 ) { i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1; }
+        else                 { i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+    }
+
+    // 3.: Hash the corners into gradients, the cube coordinates may be far beyond the table
+    int32_t ii  = static_cast<int32_t>( fi - ( 256.0 * std::floor( fi / 256.0 ) ) );
+    int32_t jj  = static_cast<int32_t>( fj - ( 256.0 * std::floor( fj / 256.0 ) ) );
+    int32_t kk  = static_cast<int32_t>( fk - ( 256.0 * std::floor( fk / 256.0 ) ) );
+    int32_t gi0 = spxPerm[ii      + spxPerm[jj      + spxPerm[kk     ]]] % 12;
+    int32_t gi1 = spxPerm[ii + i1 + spxPerm[jj + j1 + spxPerm[kk + k1]]] % 12;
+    int32_t gi2 = spxPerm[ii + i2 + spxPerm[jj + j2 + spxPerm[kk + k2]]] % 12;
+    int32_t gi3 = spxPerm[ii + 1  + spxPerm[jj + 1  + spxPerm[kk + 1 ]]] % 12;
+
+    // 4.: Add up the corners, the factor scales the result to -1.0 .. 1.0
+    double  n0 = spxCorner( gi0, x0, y0, z0 );
+    double  n1 = spxCorner( gi1, x0 - i1 + unskew, y0 - j1 + unskew, z0 - k1 + unskew );
+    double  n2 = spxCorner( gi2, x0 - i2 + ( 2. * unskew ), y0 - j2 + ( 2. * unskew ), z0 - k2 + ( 2. * unskew ) );
+    double  n3 = spxCorner( gi3, x0 - 1. + ( 3. * unskew ), y0 - 1. + ( 3. * unskew ), z0 - 1. + ( 3. * unskew ) );
+
+    return 32.0 * ( n0 + n1 + n2 + n3 );
+}
+
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef PWX_GRAVMAT_SIMPLEX_H_INCLUDED
+#define PWX_GRAVMAT_SIMPLEX_H_INCLUDED 1
+
+#include "environment.h"
+
+
+/** @brief return three dimensional simplex noise at @a x / @a y / @a z
+  *
+  * The coordinates are divided by @a zoom first, so the larger the zoom, the
+  * smoother the noise. The result lies between -1.0 and 1.0.
+  *
+  * Unlike pwx::RNG this uses nothing but a constant permutation table, so
+  * any number of threads can sample it at once without any locking. This is
+  * what the projection and the ray caster use for every pixel.
+**/
+double simplex3D( double x, double y, double z, double zoom ) PWX_WARNUNUSED;
+
+#endif // PWX_GRAVMAT_SIMPLEX_H_INCLUDED
+
@@ -0,0 +1,51 @@
+#include <pwxMathHelpers.h>
+
+#include "spherelut.h"
+
+
+/** @brief calculate the distance of the pixel edge at @a xOff / @a yOff facing the center
+  *
+  * The edge moves from the left to the center the further down the pixel is,
+  * and from the top to the center the further right it is.
+**/
+double CSphereLUT::calcEdgeDist( double xOff, double yOff ) {
+    return pwx::absDistance(
+               xOff + ( -0.5 *
+                        ( static_cast<int32_t>( yOff ) > static_cast<int32_t>( xOff ) ?
+                          xOff / yOff : 1.0 ) ), // Move from left to center the further down the pixel is
+               yOff + ( -0.5 *
+                        ( static_cast<int32_t>( xOff ) > static_cast<int32_t>( yOff ) ?
+                          yOff / xOff : 1.0 ) ), // Move from top to center the further right the pixel is
+               0., 0. ); // The center
+}
+
+
+/// @brief calculate the distance of the center of the pixel at @a xOff / @a yOff to 0/0
+double CSphereLUT::calcPointDist( double xOff, double yOff ) {
+    return pwx::absDistance( xOff, yOff, 0., 0. );
+}
+
+
+/** @brief fill the table with the distances of all offsets up to tableSize
+  *
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the table could not be allocated
+**/
+int32_t CSphereLUT::init() {
+    try {
+        table.resize( getIndex( tableSize, 0 ) );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate the sphere profile table! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    for ( int32_t a = 0; a < tableSize; ++a ) {
+        for ( int32_t b = 0; b <= a; ++b ) {
+            sProfileEntry& entry = table[getIndex( a, b )];
+            entry.pointDist = calcPointDist( a, b );
+            entry.edgeDist  = calcEdgeDist( a, b );
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef PWX_GRAVMAT_SPHERELUT_H_INCLUDED
+#define PWX_GRAVMAT_SPHERELUT_H_INCLUDED 1
+
+#include <cmath>
+#include <vector>
+
+#include "environment.h"
+
+
+/// @brief The distances of one pixel offset from the center of a unit
+struct sProfileEntry {
+    double pointDist; //!< Distance of the center of the pixel to the center of the unit
+    double edgeDist;  //!< Distance of the pixel edge facing the center to the center of the unit
+};
+
+
+/** @class CSphereLUT
+  * @brief Profile tables shared by all units, used by CMatter::projectUnit()
+  *
+  * projectUnit() walks the bottom right quarter of a unit in whole pixel
+  * offsets and mirrors the result. The distances of each offset to the center
+  * therefore only depend on the offset, and are calculated once for all units
+  * and frames. Both distances are symmetric in X and Y, so only the offsets
+  * with xOff >= yOff are stored. Offsets beyond the table are calculated.
+  *
+  * The profile of a sphere at a relative distance t from its center is
+  * cos(asin(t)), which is the same as sqrt(1 - t²). getModZ() uses the
+  * latter, which needs neither a table nor any trigonometry.
+**/
+class CSphereLUT {
+    std::vector<sProfileEntry> table; //!< Entries of all offsets with xOff >= yOff, see getIndex()
+
+    /// @brief return the table index of the offset @a a / @a b with a >= b
+    static size_t getIndex( size_t a, size_t b ) { return ( ( a * ( a + 1 ) ) / 2 ) + b; }
+
+  public:
+    static const int32_t tableSize = 512; //!< Offsets up to this value are looked up
+
+    /// @brief default ctor, the table is filled by init()
+    explicit CSphereLUT() { }
+
+    /// @brief default dtor, does nothing.
+    ~CSphereLUT() { }
+
+    // Calculate the distance of the pixel edge facing the center:
+    static double calcEdgeDist( double xOff, double yOff ) PWX_WARNUNUSED;
+
+    // Calculate the distance of the pixel center:
+    static double calcPointDist( double xOff, double yOff ) PWX_WARNUNUSED;
+
+    /// @brief return the distance of the pixel edge at @a xOff / @a yOff facing the center
+    double getEdgeDist( int32_t xOff, int32_t yOff ) const {
+        if ( ( xOff < tableSize ) && ( yOff < tableSize ) )
+            return xOff < yOff ? table[getIndex( yOff, xOff )].edgeDist : table[getIndex( xOff, yOff )].edgeDist;
+        return calcEdgeDist( xOff, yOff );
+    }
+
+    /// @brief return the sphere profile at the relative distance @a t (0 <= t <= 1) from the center
+    static double getModZ( double t ) { return std::sqrt( 1.0 - ( t * t ) ); }
+
+    /// @brief return the distance of the pixel center at @a xOff / @a yOff
+    double getPointDist( int32_t xOff, int32_t yOff ) const {
+        if ( ( xOff < tableSize ) && ( yOff < tableSize ) )
+            return xOff < yOff ? table[getIndex( yOff, xOff )].pointDist : table[getIndex( xOff, yOff )].pointDist;
+        return calcPointDist( xOff, yOff );
+    }
+
+    // Fill the table:
+    int32_t init() PWX_WARNUNUSED;
+
+  private:
+    /* --- no copying! --- */
+    CSphereLUT( CSphereLUT& );
+    CSphereLUT& operator=( CSphereLUT& );
+};
+
+#endif // PWX_GRAVMAT_SPHERELUT_H_INCLUDED
+
@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "tilebins.h"
+
+
+/** @brief sort all visible units into the bins of the tiles they touch
+  *
+  * @param[in] env Pointer to environment struct, must not be NULL
+  * @param[in] info Array of the prepared projections of all units
+  * @param[in] count Number of entries in @a info
+  * @return EXIT_SUCCESS or EXIT_FAILURE if the bins could not be allocated
+**/
+int32_t CTileBins::build( ENVIRONMENT* env, const sProjInfo* info, int32_t count ) {
+    assert( env && "ERROR: CTileBins::build() called without valid env!" );
+
+    scrHeight = env->scrHeight;
+    scrWidth  = env->scrWidth;
+    tilesX    = ( scrWidth  + tileSize - 1 ) / tileSize;
+    tilesY    = ( scrHeight + tileSize - 1 ) / tileSize;
+
+    int32_t tileCount = tilesX * tilesY;
+    int32_t tX0 = 0, tY0 = 0, tX1 = 0, tY1 = 0;
+
+    // 1.: Count the bin sizes
+    try {
+        binPos.assign( tileCount + 1, 0 );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << tileCount << " tile bins! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( getTiles( info[i], tX0, tY0, tX1, tY1 ) ) {
+            for ( int32_t tY = tY0; tY <= tY1; ++tY ) {
+                for ( int32_t tX = tX0; tX <= tX1; ++tX )
+                    ++binPos[( tY * tilesX ) + tX + 1];
+            }
+        }
+    }
+
+    // 2.: Turn the sizes into start positions...
+    for ( int32_t t = 1; t <= tileCount; ++t )
+        binPos[t] += binPos[t - 1];
+
+    try {
+        items.resize( binPos[tileCount] );
+    } catch ( std::bad_alloc& e ) {
+        cerr << "ERROR: unable to allocate " << binPos[tileCount] << " tile bin entries! [" << e.what() << "]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // 3.: ...fill the bins, which moves each start position to the start of the next bin...
+    for ( int32_t i = 0; i < count; ++i ) {
+        if ( getTiles( info[i], tX0, tY0, tX1, tY1 ) ) {
+            for ( int32_t tY = tY0; tY <= tY1; ++tY ) {
+                for ( int32_t tX = tX0; tX <= tX1; ++tX )
+                    items[binPos[( tY * tilesX ) + tX]++] = i;
+            }
+        }
+    }
+
+    // 4.: ...and move them back.
+    for ( int32_t t = tileCount; t > 0; --t )
+        binPos[t] = binPos[t - 1];
+    binPos[0] = 0;
+
+    return EXIT_SUCCESS;
+}
+
+
+/// @brief return the pixels tile @a tNr covers, the last row and column are cut at the plane edges
+sTileRect CTileBins::getRect( int32_t tNr ) const {
+    sTileRect rect;
+    rect.left   = ( tNr % tilesX ) * tileSize;
+    rect.top    = ( tNr / tilesX ) * tileSize;
+    rect.right  = std::min( rect.left + tileSize, scrWidth );
+    rect.bottom = std::min( rect.top  + tileSize, scrHeight );
+    return rect;
+}
+
+
+/// @brief determine the range of tiles the footprint of @a info touches, return false if there is none
+bool CTileBins::getTiles( const sProjInfo& info, int32_t& tX0, int32_t& tY0, int32_t& tX1, int32_t& tY1 ) const {
+    if ( !info.isVisible )
+        return false;
+
+    int32_t left   = std::max( info.x - info.reach, 0 );
+    int32_t top    = std::max( info.y - info.reach, 0 );
+    int32_t right  = std::min( info.x + info.reach, scrWidth  - 1 );
+    int32_t bottom = std::min( info.y + info.reach, scrHeight - 1 );
+
+    if ( ( left > right ) || ( top > bottom ) )
+        return false;
+
+    tX0 = left   / tileSize;
+    tY0 = top    / tileSize;
+    tX1 = right  / tileSize;
+    tY1 = bottom / tileSize;
+
+    return true;
+}
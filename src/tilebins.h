@@ -0,0 +1,94 @@
+#pragma once
+#ifndef PWX_GRAVMAT_TILEBINS_H_INCLUDED
+#define PWX_GRAVMAT_TILEBINS_H_INCLUDED 1
+
+#include <vector>
+
+#include "environment.h"
+
+
+/// @brief A rectangle of pixels, left/top are inclusive, right/bottom exclusive
+struct sTileRect {
+    int32_t left;   //!< First X-Coordinate of the rectangle
+    int32_t top;    //!< First Y-Coordinate of the rectangle
+    int32_t right;  //!< X-Coordinate right of the last column
+    int32_t bottom; //!< Y-Coordinate below the last row
+};
+
+
+/// @brief Everything CMatter::projectUnit() needs, prepared by CMatter::prepView() and CMatter::prepProject()
+struct sProjInfo {
+    CMatter* unit;      //!< The unit to project
+    bool     isVisible; //!< false if the unit does not touch the projection plane or is hidden
+    int32_t  reach;     //!< Largest offset from x/y a pixel of the unit can be drawn at
+    int32_t  x;         //!< Drawing position X value
+    int32_t  y;         //!< Drawing position Y value
+    double   z;         //!< Position on the virtual Z-Axis
+    double   vR;        //!< View radius
+    double   dR;        //!< Dust radius
+    double   dMR;       //!< Dust maximum range modifier
+    double   oR;        //!< Radius of the mass disc that hides what lies behind it, 0. for detonation rings
+    double   m;         //!< Mass in kg, the combined mass if the unit is an impostor for others
+    double   mZ;        //!< Z-Movement in m/s, mass-weighted if the unit is an impostor for others
+    uint8_t  r;         //!< Red color part
+    uint8_t  g;         //!< Green color part
+    uint8_t  b;         //!< Blue color part
+};
+
+
+/** @class CTileBins
+  * @brief Screen tiles with the units that touch them, used by the tile renderer
+  *
+  * The projection plane is cut into square tiles. Every visible unit is put
+  * into the bin of each tile its footprint (the drawing position plus/minus the
+  * reach) touches. The bins are filled by a counting sort over the unit
+  * numbers, so every bin lists its units in ascending order.
+  *
+  * A thread projecting a tile only writes pixels inside that tile, and every
+  * pixel belongs to exactly one tile. The tiles can therefore be projected in
+  * parallel without locking, and every pixel sees the units in the same order
+  * no matter how many threads are used.
+**/
+class CTileBins {
+    std::vector<int32_t> binPos;    //!< Start of each bin in items, the extra last entry is the end
+    std::vector<int32_t> items;     //!< Unit numbers ordered by tile, ascending within each bin
+    int32_t              scrHeight; //!< Height of the projection plane the tiles cover
+    int32_t              scrWidth;  //!< Width of the projection plane the tiles cover
+    int32_t              tilesX;    //!< Number of tile columns
+    int32_t              tilesY;    //!< Number of tile rows
+
+    // Determine the range of tiles the footprint of a unit touches:
+    bool getTiles( const sProjInfo& info, int32_t& tX0, int32_t& tY0, int32_t& tX1, int32_t& tY1 ) const PWX_WARNUNUSED;
+
+  public:
+    static const int32_t tileSize = 64; //!< Edge length of a tile in pixels
+
+    /// @brief default ctor, the bins are allocated by build()
+    explicit CTileBins(): scrHeight( 0 ), scrWidth( 0 ), tilesX( 0 ), tilesY( 0 ) { }
+
+    /// @brief default dtor, does nothing.
+    ~CTileBins() { }
+
+    // Sort all visible units into the bins of the tiles they touch:
+    int32_t        build( ENVIRONMENT* env, const sProjInfo* info, int32_t count ) PWX_WARNUNUSED;
+
+    /// @brief return the unit numbers in the bin of tile @a tNr
+    const int32_t* getBin( int32_t tNr ) const { return items.data() + binPos[tNr]; }
+
+    /// @brief return the number of units in the bin of tile @a tNr
+    int32_t        getBinSize( int32_t tNr ) const { return binPos[tNr + 1] - binPos[tNr]; }
+
+    // Return the pixels tile tNr covers:
+    sTileRect      getRect( int32_t tNr ) const PWX_WARNUNUSED;
+
+    /// @brief return the number of tiles
+    int32_t        size() const { return tilesX * tilesY; }
+
+  private:
+    /* --- no copying! --- */
+    CTileBins( CTileBins& );
+    CTileBins& operator=( CTileBins& );
+};
+
+#endif // PWX_GRAVMAT_TILEBINS_H_INCLUDED
+